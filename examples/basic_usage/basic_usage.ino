@@ -3,6 +3,7 @@
 Sigscoper sigscoper;
 SigscoperConfig config;
 SigscoperStats stats;
+uint32_t generation = 0;
 
 void setup() {
     Serial.begin(115200);
@@ -34,7 +35,11 @@ void setup() {
 }
 
 void loop() {
-    if (sigscoper.is_ready()) {
+    // Block until the next capture is ready, keep the last generation on timeout
+    uint32_t captured = sigscoper.wait_for_capture(generation, pdMS_TO_TICKS(1000));
+    if (captured) {
+        generation = captured;
+        
         // Get signal statistics
         if (sigscoper.get_stats(0, &stats)) {
             Serial.printf("Signal captured!\n");
@@ -45,7 +50,8 @@ void loop() {
         
         // Get signal buffer
         uint16_t buffer[128];
-        if (sigscoper.get_buffer(0, 128, buffer)) {
+        size_t position;
+        if (sigscoper.get_buffer(0, 128, buffer, &position)) {
             Serial.println("Signal buffer:");
             for (int i = 0; i < 128; i += 8) {
                 Serial.printf("%4d: %4d %4d %4d %4d %4d %4d %4d %4d\n",
@@ -57,6 +63,4 @@ void loop() {
         Serial.println("Restarting for next acquisition...");
         sigscoper.restart();
     }
-    
-    delay(100);
 } 
\ No newline at end of file
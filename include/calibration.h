@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <esp_adc/adc_oneshot.h>
+
+#define CALIBRATION_LUT_SIZE 4096
+#define MAX_CALIBRATION_POINTS 8
+
+// Calibration sources
+enum class CalibrationMode {
+    NONE,       // No calibration, millivolt API is unavailable
+    ADC_CALI,   // esp_adc_cali characterization of the ADC unit
+    POINTS      // User supplied (raw, mV) points, linear interpolation between them
+};
+
+// Single user calibration point
+struct CalibrationPoint {
+    uint16_t raw;
+    uint16_t mv;
+};
+
+// Per-channel calibration settings
+struct ChannelCalibration {
+    CalibrationMode mode;
+    size_t point_count;
+    CalibrationPoint points[MAX_CALIBRATION_POINTS];  // Sorted by raw value
+
+    ChannelCalibration() {
+        mode = CalibrationMode::ADC_CALI;
+        point_count = 0;
+        for (size_t i = 0; i < MAX_CALIBRATION_POINTS; i++) {
+            points[i] = {0, 0};
+        }
+    }
+};
+
+// Raw code to millivolt lookup table (one entry per 12-bit code)
+class Calibration {
+private:
+    uint16_t* lut_;
+    bool valid_;
+    int adc_channel_;  // Channel of the esp_adc_cali table, -1 for other sources
+
+    bool allocate();
+
+public:
+    Calibration();
+    ~Calibration();
+
+    Calibration(const Calibration&) = delete;
+    Calibration& operator=(const Calibration&) = delete;
+
+    bool build_adc_cali(adc_unit_t unit, adc_atten_t atten, adc_channel_t channel);
+    bool build_points(const CalibrationPoint* points, size_t point_count);
+    void invalidate() { valid_ = false; }
+
+    bool is_valid() const { return valid_; }
+    bool is_adc_cali(adc_channel_t channel) const { return valid_ && adc_channel_ == channel; }
+    uint16_t to_mv(uint16_t raw) const { return lut_[raw & (CALIBRATION_LUT_SIZE - 1)]; }
+    uint16_t to_mv(uint16_t sample, uint8_t extra_bits) const;  // Interpolates samples wider than 12 bits
+    void convert(const uint16_t* raw, uint16_t* mv, size_t count) const;
+    void convert(const uint16_t* samples, uint16_t* mv, size_t count, uint8_t extra_bits) const;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Each frame is stored as a header followed by raw adc_continuous_read() bytes.
+// Header layout (little endian): uint16_t length, uint32_t timestamp_us
+#define RECORDER_FRAME_HEADER_SIZE 6
+
+// Ring of raw ADC conversion frames with timing
+class Recorder {
+private:
+    uint8_t* storage_;
+    size_t capacity_;
+    bool owns_storage_;
+
+    size_t head_;         // Write position
+    size_t tail_;         // Oldest frame
+    size_t used_;         // Bytes in use
+    size_t frame_count_;
+    uint32_t dropped_frames_;
+    bool recording_;
+
+    SemaphoreHandle_t mutex_;
+
+    // Private methods
+    void write_bytes(size_t position, const uint8_t* data, size_t size);
+    void read_bytes(size_t position, uint8_t* data, size_t size) const;
+    size_t read_frame_length(size_t position) const;
+    void drop_oldest();
+
+public:
+    Recorder();
+    ~Recorder();
+
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    bool begin(size_t capacity);
+    bool begin(uint8_t* storage, size_t capacity);  // Caller owned storage (e.g. PSRAM)
+    void clear();
+
+    // Recording
+    void set_recording(bool recording) { recording_ = recording; }
+    bool is_recording() const { return recording_; }
+    bool record(const uint8_t* data, size_t length, uint32_t timestamp_us);
+
+    // Playback, cursor starts at 0 and is advanced by each call
+    bool next_frame(size_t* cursor, uint8_t* data, size_t max_length,
+                    size_t* length, uint32_t* timestamp_us) const;
+
+    // Compact image (frames oldest first) for saving to and loading from a file
+    size_t get_image_size() const { return used_; }
+    size_t read_image(size_t offset, uint8_t* data, size_t size) const;
+    bool load_image(const uint8_t* data, size_t size);
+
+    // Getters
+    size_t get_capacity() const { return capacity_; }
+    size_t get_frame_count() const { return frame_count_; }
+    uint32_t get_dropped_frames() const { return dropped_frames_; }
+};
@@ -8,12 +8,45 @@
 #include <esp_adc/adc_continuous.h>
 #include <cstring>
 #include <algorithm>
+#include <atomic>
 #include "trigger.h"
+#include "calibration.h"
+#include "trend.h"
+#include "recorder.h"
 
 #define MAX_CHANNELS 8
 #define SIGNAL_BUFFER_SIZE 2048
 #define MEDIAN_FILTER_WINDOW 3
 #define SAMPLE_RATE 20000
+#define MAX_CAPTURE_WAITERS 4
+#define MAX_GROUPS 4
+#define MAX_OVERSAMPLING_BITS 4  // 12 + 4 bits still fit 16-bit sample storage
+#define AUTOSET_PERIODS 4       // Signal periods shown after autoset
+#define AUTOSET_PROBE_SIZE 256   // Buffer size of probe captures
+#define AUTOSET_MAX_PROBES 6
+#define AUTOSET_MIN_RATE 100
+#define AUTOSET_MIN_RANGE 50     // Smaller peak-to-peak is treated as flat signal
+#define LOGIC_BUFFER_SIZE (SIGNAL_BUFFER_SIZE * 16)  // Logic channels pack 16 samples per analog sample
+
+// Channel acquisition modes
+enum class ChannelMode {
+    ANALOG,  // 12-bit samples, median filtered
+    LOGIC    // Thresholded 1-bit samples packed 32 per word
+};
+
+// Waveform averaging modes
+enum class AveragingMode {
+    NONE,
+    LINEAR,      // Mean of average_count trigger-aligned captures
+    EXPONENTIAL  // Running average with weight 1/average_count (rounded to power of two)
+};
+
+// What a group does after a capture was tested against channel masks
+enum class MaskAction {
+    STOP,             // Capture becomes ready as usual
+    REARM,            // Re-arm the trigger after every test, capture never becomes ready
+    REARM_UNTIL_FAIL  // Re-arm while captures pass, the first failing capture becomes ready
+};
 
 // Structure for signal statistics
 struct SigscoperStats {
@@ -30,6 +63,93 @@ struct SigscoperStats {
     }
 };
 
+// Extended measurement selection flags
+enum Measurement : uint32_t {
+    MEASURE_FREQUENCY    = 1 << 0,
+    MEASURE_RMS          = 1 << 1,
+    MEASURE_PEAK_TO_PEAK = 1 << 2,
+    MEASURE_DUTY_CYCLE   = 1 << 3,
+    MEASURE_RISE_TIME    = 1 << 4,
+    MEASURE_FALL_TIME    = 1 << 5,
+    MEASURE_OVERSHOOT    = 1 << 6,
+    MEASURE_JITTER       = 1 << 7,
+    MEASURE_ALL          = 0xFF
+};
+
+// Structure for extended measurements (raw units, times in seconds)
+struct SigscoperMeasurements {
+    uint32_t valid;        // Measurement flags that were computed
+    float frequency;
+    float rms;
+    float peak_to_peak;
+    float duty_cycle;      // Fraction of time above average level (0.0-1.0)
+    float rise_time;       // Average 10% to 90% transition time
+    float fall_time;       // Average 90% to 10% transition time
+    float overshoot;       // Percent of high-low amplitude
+    float period_jitter;   // Standard deviation of period
+    
+    SigscoperMeasurements() {
+        valid = 0;
+        frequency = 0;
+        rms = 0;
+        peak_to_peak = 0;
+        duty_cycle = 0;
+        rise_time = 0;
+        fall_time = 0;
+        overshoot = 0;
+        period_jitter = 0;
+    }
+};
+
+// Structure for logic channel statistics
+struct SigscoperLogicStats {
+    size_t samples;          // Number of valid samples
+    uint32_t rising_edges;
+    uint32_t falling_edges;
+    float duty_cycle;        // Fraction of samples in high state (0.0-1.0)
+    float frequency;
+    
+    SigscoperLogicStats() {
+        samples = 0;
+        rising_edges = 0;
+        falling_edges = 0;
+        duty_cycle = 0;
+        frequency = 0;
+    }
+};
+
+// Mask test counters of a channel
+struct SigscoperMaskResult {
+    uint32_t passed;
+    uint32_t failed;
+    bool has_failure;         // First failing capture is stored
+    size_t failure_violations;  // Samples outside the mask in the stored capture
+    
+    SigscoperMaskResult() {
+        passed = 0;
+        failed = 0;
+        has_failure = false;
+        failure_violations = 0;
+    }
+};
+
+// Channel group configuration, every group has its own rate, buffer and trigger
+struct ChannelGroupConfig {
+    uint32_t channel_mask;  // Bit i selects channels[i] of SigscoperConfig
+    uint32_t sampling_rate;
+    size_t buffer_size;
+    TriggerMode trigger_mode;  // Triggered by the first channel of the group
+    uint16_t trigger_level;
+    
+    ChannelGroupConfig() {
+        channel_mask = 0;
+        sampling_rate = 20000;
+        buffer_size = SIGNAL_BUFFER_SIZE;
+        trigger_mode = TriggerMode::FREE;
+        trigger_level = 2048;
+    }
+};
+
 // Sigscoper configuration structure
 struct SigscoperConfig {
     size_t channel_count;
@@ -39,6 +159,17 @@ struct SigscoperConfig {
     uint32_t sampling_rate;
     float auto_speed;  // Controls coefficient of update_auto_level (0.0-1.0)
     size_t buffer_size;  // Buffer size for signal storage
+    ChannelCalibration calibration[MAX_CHANNELS];  // Raw to millivolt conversion per channel
+    ChannelMode channel_modes[MAX_CHANNELS];
+    uint16_t logic_threshold[MAX_CHANNELS];   // Raw level between low and high state
+    uint16_t logic_hysteresis[MAX_CHANNELS];  // Half-width of the dead band around threshold
+    size_t logic_buffer_size;  // Logic channel history in samples (limited by LOGIC_BUFFER_SIZE)
+    AveragingMode averaging_mode;
+    uint32_t average_count;  // Captures per average (LINEAR) or averaging weight (EXPONENTIAL)
+    MaskAction mask_action;  // Group behaviour after a mask test
+    uint8_t oversampling_bits;  // Extra resolution bits from summing 4^n ADC samples per sample
+    size_t group_count;  // 0: all channels form one group with the fields above
+    ChannelGroupConfig groups[MAX_GROUPS];
     
     SigscoperConfig() {
         channel_count = 0;
@@ -47,18 +178,61 @@ struct SigscoperConfig {
         sampling_rate = 20000;
         auto_speed = 0.002f;  // Default value (equivalent to previous 0.0002)
         buffer_size = SIGNAL_BUFFER_SIZE;  // Default buffer size
+        logic_buffer_size = LOGIC_BUFFER_SIZE;
+        averaging_mode = AveragingMode::NONE;
+        average_count = 16;
+        mask_action = MaskAction::STOP;
+        oversampling_bits = 0;
+        group_count = 0;
         memset(channels, 0, sizeof(channels));
+        for (size_t i = 0; i < MAX_CHANNELS; i++) {
+            channel_modes[i] = ChannelMode::ANALOG;
+            logic_threshold[i] = 2048;
+            logic_hysteresis[i] = 200;
+        }
     }
 };
 
 class Sigscoper {
 private:
+    // Acquisition state of a channel group
+    struct GroupState {
+        Trigger trigger;
+        uint32_t sampling_rate;  // Effective rate after decimation
+        uint32_t decimation_factor;
+        uint32_t sample_counter;
+        size_t buffer_size;      // Limited by SIGNAL_BUFFER_SIZE
+        size_t first_channel;    // Trigger source, first in pattern order
+        size_t last_channel;
+        uint32_t averaged_captures;
+        std::atomic<bool> done;  // Capture completed, group is not recording
+        std::atomic<uint32_t> generation;  // Incremented on every completed group capture
+    };
+    
+    // Envelope mask of a channel, all arrays are allocated by set_mask()
+    struct MaskState {
+        uint16_t* lower;    // Followed by upper and failure in one allocation
+        uint16_t* upper;
+        uint16_t* failure;  // First failing capture, oldest sample first
+        size_t length;
+        SigscoperMaskResult result;
+    };
+    
     // Configuration
     SigscoperConfig config_;
-    size_t buffer_size_;  // Internal buffer size (limited by SIGNAL_BUFFER_SIZE)
+    
+    // Channel groups
+    GroupState groups_[MAX_GROUPS];
+    size_t group_count_;
+    size_t channel_groups_[MAX_CHANNELS];
+    uint32_t adc_sample_freq_;
     
     // ADC
     adc_continuous_handle_t adc_handle_;
+    bool adc_configured_;  // Last applied configuration, to skip unchanged reconfiguration
+    uint32_t adc_config_freq_;
+    size_t adc_config_channel_count_;
+    adc_channel_t adc_config_channels_[MAX_CHANNELS];
     
     // Task
     TaskHandle_t read_task_handle_;
@@ -67,34 +241,104 @@ private:
     SemaphoreHandle_t mutex_;
     SemaphoreHandle_t start_semaphore_;
     
-    // State
-    bool running_;
-    bool stop_requested_;
-    bool is_ready_;
-    uint32_t decimation_factor_;
-    uint32_t sample_counter_;
+    // State (shared between read task and consumers)
+    std::atomic<bool> running_;
+    std::atomic<bool> stop_requested_;
+    std::atomic<bool> is_ready_;
+    std::atomic<bool> task_active_;  // Read task is processing ADC frames
+    std::atomic<uint32_t> capture_generation_;  // Incremented on every ready capture, 0 is never used
+    TaskHandle_t capture_waiters_[MAX_CAPTURE_WAITERS];
     
     // Data
-    uint16_t signal_buffers_[MAX_CHANNELS][SIGNAL_BUFFER_SIZE];
-    size_t buffer_indices_[MAX_CHANNELS];
+    union ChannelStorage {
+        uint16_t samples[SIGNAL_BUFFER_SIZE];    // Analog channels
+        uint32_t bits[LOGIC_BUFFER_SIZE / 32];  // Logic channels, LSB is the oldest sample
+    };
+    ChannelStorage signal_buffers_[MAX_CHANNELS];
+    size_t buffer_indices_[MAX_CHANNELS];  // Sample index for analog, bit index for logic channels
+    
+    // Logic channels
+    size_t logic_size_;  // Ring size in bits (multiple of 32)
+    size_t logic_filled_[MAX_CHANNELS];
+    bool logic_states_[MAX_CHANNELS];
+    
+    // Averaging
+    int32_t* accumulators_;  // Channel after channel, oldest sample first
+    size_t accumulators_capacity_;
+    size_t accumulator_offsets_[MAX_CHANNELS];
+    uint8_t average_shift_;
     
-    // Trigger
-    Trigger trigger_;
+    // Measurements cached per capture generation
+    mutable SigscoperMeasurements measurement_cache_[MAX_CHANNELS];
+    mutable uint32_t measurement_generations_[MAX_CHANNELS];
+    
+    // Mask testing
+    MaskState masks_[MAX_CHANNELS];
+    std::atomic<bool> masks_enabled_;  // Cleared while autoset probes
+    
+    // Oversampling accumulators of decimated-away samples
+    uint32_t oversample_sums_[MAX_CHANNELS];
+    uint32_t oversample_counts_[MAX_CHANNELS];
     
     // Median filter
     uint16_t median_buffers_[MAX_CHANNELS][MEDIAN_FILTER_WINDOW];
     size_t median_indices_[MAX_CHANNELS];
     bool median_initialized_[MAX_CHANNELS];
     
+    // Calibration
+    Calibration adc_calibration_;  // Shared by ADC_CALI channels unless the chip compensates per channel
+    Calibration channel_calibrations_[MAX_CHANNELS];
+    const Calibration* calibrations_[MAX_CHANNELS];
+    
+    // Trend history fed with every completed capture (optional)
+    Trend* trend_;
+    
+    // Raw frame recorder fed by the read task (optional)
+    Recorder* recorder_;
+    
     // Constants
     static constexpr size_t CONV_FRAME_SIZE = 1024;
     
     // Private methods
     static void read_task_wrapper(void* param);
     void read_task();
+    bool configure_groups();
+    void reset_acquisition();
+    void wait_for_task_idle() const;
+    void finish_group(size_t group_index);
+    uint32_t get_adc_sample_freq() const { return adc_sample_freq_; }
+    size_t channel_buffer_size(size_t channel_index) const { return groups_[channel_groups_[channel_index]].buffer_size; }
+    uint32_t channel_rate(size_t channel_index) const { return groups_[channel_groups_[channel_index]].sampling_rate; }
+    bool is_adc_configured(const adc_continuous_config_t& dig_cfg) const;
+    void process_frame(const uint8_t* data, size_t size);
     void process_sample(size_t channel_index, uint16_t sample);
     uint16_t apply_median_filter(size_t channel_index, uint16_t sample);
+    uint16_t take_oversampled(size_t channel_index);
     float calculate_frequency_from_buffer_direct(size_t channel_index) const;
+    const SigscoperMeasurements& get_cached_measurements(size_t channel_index, uint32_t mask) const;
+    void measure_channel(size_t channel_index, uint32_t mask, SigscoperMeasurements* result) const;
+    bool calculate_lag(size_t a, size_t b, size_t max_lag, float* lag) const;
+    void build_calibrations();
+    bool calculate_stats(size_t index, const Calibration* calibration, SigscoperStats* stats) const;
+    void update_trend();
+    void signal_capture();
+    void notify_waiters();
+    static uint32_t next_generation(uint32_t generation);
+    uint32_t wait_for_generation(const std::atomic<uint32_t>& counter, uint32_t newer_than, TickType_t timeout);
+    bool allocate_accumulators();
+    bool complete_capture(size_t group_index);
+    bool accumulate_capture(size_t group_index);
+    bool test_masks(size_t group_index, bool* failed);
+    bool is_averaged(size_t channel_index) const {
+        return config_.averaging_mode != AveragingMode::NONE &&
+               groups_[channel_groups_[channel_index]].averaged_captures > 0;
+    }
+    uint16_t get_sample(size_t channel_index, size_t i) const;
+    bool is_logic(size_t index) const { return config_.channel_modes[index] == ChannelMode::LOGIC; }
+    void process_logic_sample(size_t channel_index, uint16_t sample);
+    void reset_logic_history(size_t group_index);
+    uint32_t get_logic_word(size_t channel_index, size_t bit_position) const;
+    void calculate_logic_stats(size_t channel_index, SigscoperLogicStats* stats) const;
 
 public:
     Sigscoper();
@@ -105,15 +349,62 @@ public:
     bool start(const SigscoperConfig& config);
     void stop();
     void restart();
+    void restart_group(size_t group_index);
+    void set_trend(Trend* trend) { trend_ = trend; }
+    void set_recorder(Recorder* recorder) { recorder_ = recorder; }
+    
+    // Pick sampling rate and trigger for the signal on channel 0, update config and start with it
+    bool autoset(SigscoperConfig* config, TickType_t timeout = portMAX_DELAY);
+    
+    // Feed recorded frames through the acquisition pipeline instead of the ADC
+    bool replay(const SigscoperConfig& config, const Recorder& recorder, size_t* cursor = nullptr);
     
     // Getters
     bool is_running() const { return running_; }
-    bool is_trigger_fired() const { return trigger_.is_fired(); }
-    uint16_t get_trigger_threshold() const { return trigger_.get_threshold(); }
+    bool is_trigger_fired() const { return groups_[0].trigger.is_fired(); }
+    uint16_t get_trigger_threshold() const { return groups_[0].trigger.get_threshold(); }
     size_t get_max_channels() const { return MAX_CHANNELS; }
+    uint8_t get_resolution_bits() const { return 12 + config_.oversampling_bits; }
     bool is_ready() const { return is_ready_; }
+    uint32_t get_averaged_captures() const { return groups_[0].averaged_captures; }
+    size_t get_group_count() const { return group_count_; }
+    bool is_group_ready(size_t group_index) const { return group_index < group_count_ && groups_[group_index].done; }
+    uint32_t get_group_sampling_rate(size_t group_index) const {
+        return group_index < group_count_ ? groups_[group_index].sampling_rate : 0;
+    }
+    uint32_t get_capture_generation() const { return capture_generation_; }
+    uint32_t get_group_generation(size_t group_index) const {
+        return group_index < group_count_ ? groups_[group_index].generation.load() : 0;
+    }
+    
+    // Block until a capture newer than the given generation is ready, returns its generation or 0 on timeout
+    uint32_t wait_for_capture(uint32_t newer_than, TickType_t timeout = portMAX_DELAY);
+    
+    // Same for one channel group, signalled as soon as that group completes
+    uint32_t wait_for_group(size_t group_index, uint32_t newer_than, TickType_t timeout = portMAX_DELAY);
     
     // Data operations
     bool get_buffer(size_t index, size_t size, uint16_t* buffer, size_t* position) const;
     bool get_stats(size_t index, SigscoperStats* stats) const;
+    bool get_measurements(size_t index, uint32_t mask, SigscoperMeasurements* measurements) const;
+    
+    // Cross-channel operations, positive when channel b lags channel a
+    bool get_delay(size_t a, size_t b, float* delay, size_t max_lag = 0) const;  // Seconds
+    bool get_phase(size_t a, size_t b, float* phase, size_t max_lag = 0) const;  // Degrees
+    
+    // Logic channel operations
+    bool get_logic_buffer(size_t index, size_t words, uint32_t* buffer, size_t* position) const;
+    bool get_logic_stats(size_t index, SigscoperLogicStats* stats) const;
+    
+    // Mask testing, masks are in stored sample units (get_resolution_bits()) and cover the first length samples
+    bool set_mask(size_t index, const uint16_t* lower, const uint16_t* upper, size_t length);
+    void clear_mask(size_t index);
+    void reset_mask_result(size_t index);
+    bool get_mask_result(size_t index, SigscoperMaskResult* result) const;
+    bool get_mask_failure(size_t index, size_t size, uint16_t* buffer) const;
+    
+    // Calibrated data operations (values in millivolts)
+    bool has_calibration(size_t index) const;
+    bool get_buffer_mv(size_t index, size_t size, uint16_t* buffer, size_t* position) const;
+    bool get_stats_mv(size_t index, SigscoperStats* stats) const;
 }; 
\ No newline at end of file
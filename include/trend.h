@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#define TREND_MAX_SCALES 4
+#define TREND_HISTORY_LENGTH 60
+
+struct SigscoperStats;
+
+// Aggregated statistics of one trend bucket
+struct TrendPoint {
+    uint32_t timestamp_ms;  // Start of the bucket
+    uint32_t count;         // Number of captures aggregated in the bucket
+    uint16_t min_value;
+    uint16_t max_value;
+    float avg_value;
+    float frequency;        // Average of captures with detected frequency
+
+    TrendPoint() {
+        timestamp_ms = 0;
+        count = 0;
+        min_value = UINT16_MAX;
+        max_value = 0;
+        avg_value = 0;
+        frequency = 0;
+    }
+};
+
+// Rolling min/max/avg/frequency histories at several timescales
+class Trend {
+private:
+    // Bucket that is being filled
+    struct Accumulator {
+        uint32_t start_ms;
+        uint32_t count;
+        uint32_t frequency_count;
+        uint16_t min_value;
+        uint16_t max_value;
+        float avg_sum;
+        float frequency_sum;
+    };
+
+    // History ring of one channel at one timescale
+    struct Scale {
+        Accumulator accumulator;
+        size_t head;
+        size_t count;
+        TrendPoint points[TREND_HISTORY_LENGTH];
+    };
+
+    size_t channel_count_;
+    size_t scale_count_;
+    uint32_t periods_ms_[TREND_MAX_SCALES];
+    Scale* scales_;  // [channel][scale]
+    SemaphoreHandle_t mutex_;
+
+    // Private methods
+    Scale* get_scale(size_t channel, size_t scale) const;
+    static void reset_accumulator(Accumulator* accumulator, uint32_t start_ms);
+    static void commit(Scale* scale);
+    static void fill_point(const Accumulator& accumulator, TrendPoint* point);
+
+public:
+    Trend();
+    ~Trend();
+
+    Trend(const Trend&) = delete;
+    Trend& operator=(const Trend&) = delete;
+
+    // Default timescales are 1 s, 1 min and 1 h buckets
+    bool begin(size_t channel_count);
+    bool begin(size_t channel_count, const uint32_t* periods_ms, size_t scale_count);
+    void reset();
+
+    // Aggregate one completed capture, constant time
+    void update(size_t channel, const SigscoperStats& stats, uint32_t now_ms);
+
+    // Getters
+    size_t get_channel_count() const { return channel_count_; }
+    size_t get_scale_count() const { return scale_count_; }
+    uint32_t get_period_ms(size_t scale) const { return scale < scale_count_ ? periods_ms_[scale] : 0; }
+    size_t get_history(size_t channel, size_t scale, TrendPoint* points, size_t max_points) const;
+    bool get_current(size_t channel, size_t scale, TrendPoint* point) const;
+};
@@ -0,0 +1,143 @@
+#include "calibration.h"
+#include <esp_adc/adc_cali.h>
+#include <esp_adc/adc_cali_scheme.h>
+#include <new>
+
+Calibration::Calibration() {
+    lut_ = nullptr;
+    valid_ = false;
+    adc_channel_ = -1;
+}
+
+Calibration::~Calibration() {
+    delete[] lut_;
+    lut_ = nullptr;
+}
+
+bool Calibration::allocate() {
+    // Table is allocated once and reused by subsequent builds
+    if (!lut_) {
+        lut_ = new (std::nothrow) uint16_t[CALIBRATION_LUT_SIZE];
+    }
+    return lut_ != nullptr;
+}
+
+bool Calibration::build_adc_cali(adc_unit_t unit, adc_atten_t atten, adc_channel_t channel) {
+    valid_ = false;
+    adc_channel_ = -1;
+    if (!allocate()) {
+        return false;
+    }
+
+    adc_cali_handle_t handle = nullptr;
+    esp_err_t err = ESP_ERR_NOT_SUPPORTED;
+
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    adc_cali_curve_fitting_config_t cali_config = {
+        .unit_id = unit,
+        .chan = channel,
+        .atten = atten,
+        .bitwidth = ADC_BITWIDTH_12,
+    };
+    err = adc_cali_create_scheme_curve_fitting(&cali_config, &handle);
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+    (void)channel;  // Line fitting characterizes the whole unit
+    adc_cali_line_fitting_config_t cali_config = {
+        .unit_id = unit,
+        .atten = atten,
+        .bitwidth = ADC_BITWIDTH_12,
+    };
+    err = adc_cali_create_scheme_line_fitting(&cali_config, &handle);
+#endif
+
+    if (err != ESP_OK) {
+        return false;
+    }
+
+    // Evaluate the characterization once for every code
+    for (size_t raw = 0; raw < CALIBRATION_LUT_SIZE; raw++) {
+        int mv = 0;
+        if (adc_cali_raw_to_voltage(handle, static_cast<int>(raw), &mv) != ESP_OK) {
+            mv = 0;
+        }
+        lut_[raw] = static_cast<uint16_t>(mv < 0 ? 0 : (mv > UINT16_MAX ? UINT16_MAX : mv));
+    }
+
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    adc_cali_delete_scheme_curve_fitting(handle);
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+    adc_cali_delete_scheme_line_fitting(handle);
+#endif
+
+    adc_channel_ = channel;
+    valid_ = true;
+    return true;
+}
+
+bool Calibration::build_points(const CalibrationPoint* points, size_t point_count) {
+    valid_ = false;
+    adc_channel_ = -1;
+    if (!points || point_count < 2 || point_count > MAX_CALIBRATION_POINTS) {
+        return false;
+    }
+
+    // Points must be strictly increasing in raw value
+    for (size_t i = 1; i < point_count; i++) {
+        if (points[i].raw <= points[i - 1].raw) {
+            return false;
+        }
+    }
+
+    if (!allocate()) {
+        return false;
+    }
+
+    // Piecewise linear interpolation, first and last segments are extrapolated
+    size_t segment = 0;
+    for (size_t raw = 0; raw < CALIBRATION_LUT_SIZE; raw++) {
+        while (segment + 2 < point_count && raw > points[segment + 1].raw) {
+            segment++;
+        }
+
+        const CalibrationPoint& p0 = points[segment];
+        const CalibrationPoint& p1 = points[segment + 1];
+        int32_t mv = p0.mv + (static_cast<int32_t>(raw) - p0.raw) * (p1.mv - p0.mv) / (p1.raw - p0.raw);
+        lut_[raw] = static_cast<uint16_t>(mv < 0 ? 0 : (mv > UINT16_MAX ? UINT16_MAX : mv));
+    }
+
+    valid_ = true;
+    return true;
+}
+
+void Calibration::convert(const uint16_t* raw, uint16_t* mv, size_t count) const {
+    for (size_t i = 0; i < count; i++) {
+        mv[i] = lut_[raw[i] & (CALIBRATION_LUT_SIZE - 1)];
+    }
+}
+
+uint16_t Calibration::to_mv(uint16_t sample, uint8_t extra_bits) const {
+    if (extra_bits == 0) {
+        return to_mv(sample);
+    }
+
+    // Linear interpolation between neighbouring codes using the extra bits
+    size_t raw = (sample >> extra_bits) & (CALIBRATION_LUT_SIZE - 1);
+    if (raw == CALIBRATION_LUT_SIZE - 1) {
+        return lut_[raw];
+    }
+
+    int32_t fraction = sample & ((1u << extra_bits) - 1);
+    int32_t step = static_cast<int32_t>(lut_[raw + 1]) - lut_[raw];
+    return static_cast<uint16_t>(lut_[raw] + ((step * fraction) >> extra_bits));
+}
+
+void Calibration::convert(const uint16_t* samples, uint16_t* mv, size_t count, uint8_t extra_bits) const {
+    if (extra_bits == 0) {
+        convert(samples, mv, count);
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        mv[i] = to_mv(samples[i], extra_bits);
+    }
+}
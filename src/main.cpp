@@ -27,11 +27,9 @@ void setup() {
         for(;;);
     }
 
-    delay(10);
-
-    while(!signal_monitor.is_ready()) {
-        Serial.println("Waiting for signal monitor to be ready");
-        delay(10);
+    uint32_t generation = signal_monitor.wait_for_capture(0, pdMS_TO_TICKS(1000));
+    if (!generation) {
+        Serial.println("Timeout waiting for signal monitor to be ready");
     }
     
     SigscoperStats stats;
@@ -48,11 +46,8 @@ void setup() {
     signal_config.sampling_rate = 25000;
     signal_monitor.start(signal_config);
 
-    delay(10);
-
-    while(!signal_monitor.is_ready()) {
-        Serial.println("Waiting for signal monitor to be ready");
-        delay(10);
+    if (!signal_monitor.wait_for_capture(generation, pdMS_TO_TICKS(1000))) {
+        Serial.println("Timeout waiting for signal monitor to be ready");
     }
 
     signal_monitor.get_stats(0, &stats);
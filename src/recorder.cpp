@@ -0,0 +1,236 @@
+#include "recorder.h"
+#include <cstring>
+#include <new>
+
+Recorder::Recorder() {
+    storage_ = nullptr;
+    capacity_ = 0;
+    owns_storage_ = false;
+
+    head_ = 0;
+    tail_ = 0;
+    used_ = 0;
+    frame_count_ = 0;
+    dropped_frames_ = 0;
+    recording_ = false;
+
+    mutex_ = nullptr;
+}
+
+Recorder::~Recorder() {
+    if (owns_storage_) {
+        delete[] storage_;
+    }
+    storage_ = nullptr;
+
+    if (mutex_) {
+        vSemaphoreDelete((SemaphoreHandle_t)mutex_);
+        mutex_ = nullptr;
+    }
+}
+
+bool Recorder::begin(size_t capacity) {
+    if (storage_ || capacity <= RECORDER_FRAME_HEADER_SIZE) {
+        return false;
+    }
+
+    uint8_t* storage = new (std::nothrow) uint8_t[capacity];
+    if (!storage) {
+        return false;
+    }
+
+    if (!begin(storage, capacity)) {
+        delete[] storage;
+        return false;
+    }
+
+    owns_storage_ = true;
+    return true;
+}
+
+bool Recorder::begin(uint8_t* storage, size_t capacity) {
+    if (storage_ || !storage || capacity <= RECORDER_FRAME_HEADER_SIZE) {
+        return false;
+    }
+
+    mutex_ = xSemaphoreCreateMutex();
+    if (!mutex_) {
+        return false;
+    }
+
+    storage_ = storage;
+    capacity_ = capacity;
+    owns_storage_ = false;
+    clear();
+
+    return true;
+}
+
+void Recorder::clear() {
+    if (!mutex_) {
+        return;
+    }
+
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        head_ = 0;
+        tail_ = 0;
+        used_ = 0;
+        frame_count_ = 0;
+        dropped_frames_ = 0;
+
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+}
+
+void Recorder::write_bytes(size_t position, const uint8_t* data, size_t size) {
+    size_t first = capacity_ - position;
+    if (first >= size) {
+        memcpy(&storage_[position], data, size);
+    } else {
+        memcpy(&storage_[position], data, first);
+        memcpy(storage_, data + first, size - first);
+    }
+}
+
+void Recorder::read_bytes(size_t position, uint8_t* data, size_t size) const {
+    size_t first = capacity_ - position;
+    if (first >= size) {
+        memcpy(data, &storage_[position], size);
+    } else {
+        memcpy(data, &storage_[position], first);
+        memcpy(data + first, storage_, size - first);
+    }
+}
+
+size_t Recorder::read_frame_length(size_t position) const {
+    uint8_t header[2];
+    read_bytes(position, header, sizeof(header));
+    return header[0] | (header[1] << 8);
+}
+
+void Recorder::drop_oldest() {
+    size_t frame_size = RECORDER_FRAME_HEADER_SIZE + read_frame_length(tail_);
+    tail_ = (tail_ + frame_size) % capacity_;
+    used_ -= frame_size;
+    frame_count_--;
+    dropped_frames_++;
+}
+
+bool Recorder::record(const uint8_t* data, size_t length, uint32_t timestamp_us) {
+    if (!storage_ || !recording_ || !data || length > UINT16_MAX) {
+        return false;
+    }
+
+    size_t frame_size = RECORDER_FRAME_HEADER_SIZE + length;
+    if (frame_size > capacity_) {
+        return false;
+    }
+
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        // Overwrite the oldest frames when the ring is full
+        while (capacity_ - used_ < frame_size) {
+            drop_oldest();
+        }
+
+        uint8_t header[RECORDER_FRAME_HEADER_SIZE] = {
+            static_cast<uint8_t>(length),
+            static_cast<uint8_t>(length >> 8),
+            static_cast<uint8_t>(timestamp_us),
+            static_cast<uint8_t>(timestamp_us >> 8),
+            static_cast<uint8_t>(timestamp_us >> 16),
+            static_cast<uint8_t>(timestamp_us >> 24),
+        };
+        write_bytes(head_, header, sizeof(header));
+        write_bytes((head_ + sizeof(header)) % capacity_, data, length);
+
+        head_ = (head_ + frame_size) % capacity_;
+        used_ += frame_size;
+        frame_count_++;
+
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+        return true;
+    }
+
+    return false;
+}
+
+bool Recorder::next_frame(size_t* cursor, uint8_t* data, size_t max_length,
+                          size_t* length, uint32_t* timestamp_us) const {
+    if (!storage_ || !cursor || !data || !length) {
+        return false;
+    }
+
+    bool result = false;
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        if (*cursor + RECORDER_FRAME_HEADER_SIZE <= used_) {
+            size_t position = (tail_ + *cursor) % capacity_;
+            uint8_t header[RECORDER_FRAME_HEADER_SIZE];
+            read_bytes(position, header, sizeof(header));
+
+            size_t frame_length = header[0] | (header[1] << 8);
+            if (frame_length <= max_length) {
+                read_bytes((position + sizeof(header)) % capacity_, data, frame_length);
+                *length = frame_length;
+                if (timestamp_us) {
+                    *timestamp_us = header[2] | (header[3] << 8) | (header[4] << 16) |
+                                    (static_cast<uint32_t>(header[5]) << 24);
+                }
+                *cursor += sizeof(header) + frame_length;
+                result = true;
+            }
+        }
+
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+
+    return result;
+}
+
+size_t Recorder::read_image(size_t offset, uint8_t* data, size_t size) const {
+    if (!storage_ || !data) {
+        return 0;
+    }
+
+    size_t copied = 0;
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        if (offset < used_) {
+            copied = (size < used_ - offset) ? size : used_ - offset;
+            read_bytes((tail_ + offset) % capacity_, data, copied);
+        }
+
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+
+    return copied;
+}
+
+bool Recorder::load_image(const uint8_t* data, size_t size) {
+    if (!storage_ || !data || size > capacity_) {
+        return false;
+    }
+
+    // Image must consist of whole frames
+    size_t frames = 0;
+    size_t position = 0;
+    while (position + RECORDER_FRAME_HEADER_SIZE <= size) {
+        position += RECORDER_FRAME_HEADER_SIZE + (data[position] | (data[position + 1] << 8));
+        frames++;
+    }
+    if (position != size) {
+        return false;
+    }
+
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        memcpy(storage_, data, size);
+        head_ = size % capacity_;
+        tail_ = 0;
+        used_ = size;
+        frame_count_ = frames;
+        dropped_frames_ = 0;
+
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+        return true;
+    }
+
+    return false;
+}
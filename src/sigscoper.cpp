@@ -2,24 +2,44 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
+#include <soc/soc_caps.h>
 #include <cstring>
 #include <algorithm>
+#include <cmath>
+#include <new>
 
 Sigscoper::Sigscoper() : Sigscoper(SIGNAL_BUFFER_SIZE) {
 }
 
-Sigscoper::Sigscoper(size_t buffer_size) : trigger_() {
+Sigscoper::Sigscoper(size_t buffer_size) {
     // Configuration initialization
     config_.channel_count = 0;
     config_.trigger_mode = TriggerMode::FREE;
     config_.trigger_level = 2048;
     memset(config_.channels, 0, sizeof(config_.channels));
     
-    // Buffer size initialization
-    buffer_size_ = (buffer_size > SIGNAL_BUFFER_SIZE) ? SIGNAL_BUFFER_SIZE : buffer_size;
+    // Group initialization, single group until the first start
+    group_count_ = 1;
+    for (size_t i = 0; i < MAX_GROUPS; i++) {
+        groups_[i].sampling_rate = config_.sampling_rate;
+        groups_[i].decimation_factor = 1;
+        groups_[i].sample_counter = 0;
+        groups_[i].buffer_size = (buffer_size > SIGNAL_BUFFER_SIZE) ? SIGNAL_BUFFER_SIZE : buffer_size;
+        groups_[i].first_channel = 0;
+        groups_[i].last_channel = 0;
+        groups_[i].averaged_captures = 0;
+        groups_[i].done = false;
+        groups_[i].generation = 0;
+    }
+    memset(channel_groups_, 0, sizeof(channel_groups_));
+    adc_sample_freq_ = config_.sampling_rate;
     
     // ADC initialization
     adc_handle_ = nullptr;
+    adc_configured_ = false;
+    adc_config_freq_ = 0;
+    adc_config_channel_count_ = 0;
+    memset(adc_config_channels_, 0, sizeof(adc_config_channels_));
     
     // Task initialization
     read_task_handle_ = nullptr;
@@ -32,17 +52,56 @@ Sigscoper::Sigscoper(size_t buffer_size) : trigger_() {
     running_ = false;
     stop_requested_ = false;
     is_ready_ = false;
-    decimation_factor_ = 1;
-    sample_counter_ = 0;
+    task_active_ = false;
+    capture_generation_ = 0;
+    memset(capture_waiters_, 0, sizeof(capture_waiters_));
     
     // Data initialization
     memset(signal_buffers_, 0, sizeof(signal_buffers_));
     memset(buffer_indices_, 0, sizeof(buffer_indices_));
     
+    // Logic channel initialization
+    logic_size_ = LOGIC_BUFFER_SIZE;
+    memset(logic_filled_, 0, sizeof(logic_filled_));
+    memset(logic_states_, 0, sizeof(logic_states_));
+    
     // Median filter initialization
     memset(median_buffers_, 0, sizeof(median_buffers_));
     memset(median_indices_, 0, sizeof(median_indices_));
     memset(median_initialized_, 0, sizeof(median_initialized_));
+    
+    // Oversampling initialization
+    memset(oversample_sums_, 0, sizeof(oversample_sums_));
+    memset(oversample_counts_, 0, sizeof(oversample_counts_));
+    
+    // Calibration initialization
+    for (size_t i = 0; i < MAX_CHANNELS; i++) {
+        calibrations_[i] = nullptr;
+    }
+    
+    // Measurement cache initialization
+    memset(measurement_generations_, 0, sizeof(measurement_generations_));
+    
+    // Trend initialization
+    trend_ = nullptr;
+    
+    // Recorder initialization
+    recorder_ = nullptr;
+    
+    // Averaging initialization
+    accumulators_ = nullptr;
+    accumulators_capacity_ = 0;
+    memset(accumulator_offsets_, 0, sizeof(accumulator_offsets_));
+    average_shift_ = 0;
+    
+    // Mask initialization
+    masks_enabled_ = true;
+    for (size_t i = 0; i < MAX_CHANNELS; i++) {
+        masks_[i].lower = nullptr;
+        masks_[i].upper = nullptr;
+        masks_[i].failure = nullptr;
+        masks_[i].length = 0;
+    }
 }
 
 Sigscoper::~Sigscoper() {
@@ -73,6 +132,14 @@ Sigscoper::~Sigscoper() {
         adc_continuous_deinit(adc_handle_);
         adc_handle_ = nullptr;
     }
+    
+    delete[] accumulators_;
+    accumulators_ = nullptr;
+    
+    for (size_t i = 0; i < MAX_CHANNELS; i++) {
+        delete[] masks_[i].lower;
+        masks_[i].lower = nullptr;
+    }
 }
 
 bool Sigscoper::begin() {
@@ -123,11 +190,20 @@ bool Sigscoper::start(const SigscoperConfig& config) {
         return false;
     }
     
+    wait_for_task_idle();
+    
     // Save configuration
     config_ = config;
     
-    // Update internal buffer size (limited by SIGNAL_BUFFER_SIZE)
-    buffer_size_ = (config_.buffer_size > SIGNAL_BUFFER_SIZE) ? SIGNAL_BUFFER_SIZE : config_.buffer_size;
+    if (!configure_groups()) {
+        Serial.println("::start: invalid channel groups");
+        return false;
+    }
+    
+    if (!allocate_accumulators()) {
+        Serial.println("::start: failed to allocate averaging accumulators");
+        return false;
+    }
     
     // Configure patterns for all channels
     adc_digi_pattern_config_t adc_pattern[MAX_CHANNELS];
@@ -143,78 +219,363 @@ bool Sigscoper::start(const SigscoperConfig& config) {
     adc_continuous_config_t dig_cfg = {
         .pattern_num = static_cast<uint32_t>(config_.channel_count),
         .adc_pattern = adc_pattern,
-        .sample_freq_hz = (config_.sampling_rate < 20000) ? 
-            ((20000 + config_.sampling_rate - 1) / config_.sampling_rate) * config_.sampling_rate : 
-            config_.sampling_rate,
+        .sample_freq_hz = get_adc_sample_freq(),
         .conv_mode = ADC_CONV_SINGLE_UNIT_1,
         .format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
     };
     
-    // Check if ADC is already running
-    if (adc_handle_) {
-        // Try to stop if it's running
-        // adc_continuous_stop(adc_handle_);
+    // Reconfigure ADC only if pattern or frequency changed
+    if (!is_adc_configured(dig_cfg)) {
+        adc_configured_ = false;
+        
+        esp_err_t err = adc_continuous_config(adc_handle_, &dig_cfg);
+        if (err != ESP_OK) {
+            // If configuration failed, deinit handle
+            adc_continuous_deinit(adc_handle_);
+            adc_handle_ = nullptr;
+            return false;
+        }
+        
+        adc_configured_ = true;
+        adc_config_freq_ = dig_cfg.sample_freq_hz;
+        adc_config_channel_count_ = config_.channel_count;
+        memcpy(adc_config_channels_, config_.channels, sizeof(adc_config_channels_));
     }
     
-    esp_err_t err = adc_continuous_config(adc_handle_, &dig_cfg);
+    // Start ADC
+    esp_err_t err = adc_continuous_start(adc_handle_);
     if (err != ESP_OK) {
-        // If configuration failed, deinit handle
         adc_continuous_deinit(adc_handle_);
         adc_handle_ = nullptr;
+        adc_configured_ = false;
         return false;
     }
     
-    // Start ADC
-    err = adc_continuous_start(adc_handle_);
-    if (err != ESP_OK) {
-        adc_continuous_deinit(adc_handle_);
-        adc_handle_ = nullptr;
+    reset_acquisition();
+
+    running_ = true;
+    stop_requested_ = false;
+    
+    // Start the task
+    xSemaphoreGive((SemaphoreHandle_t)start_semaphore_);
+    
+    return true;
+}
+
+void Sigscoper::wait_for_task_idle() const {
+    // Read task may still be finishing a frame after stop(), state must not change under it
+    while (task_active_) {
+        vTaskDelay(1);
+    }
+}
+
+bool Sigscoper::is_adc_configured(const adc_continuous_config_t& dig_cfg) const {
+    if (!adc_configured_ || adc_config_freq_ != dig_cfg.sample_freq_hz ||
+        adc_config_channel_count_ != config_.channel_count) {
+        return false;
+    }
+    
+    for (size_t i = 0; i < config_.channel_count; i++) {
+        if (adc_config_channels_[i] != config_.channels[i]) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool Sigscoper::configure_groups() {
+    // Legacy configuration is a single group of all channels
+    ChannelGroupConfig legacy;
+    const ChannelGroupConfig* groups = config_.groups;
+    size_t group_count = config_.group_count;
+    
+    if (group_count == 0) {
+        legacy.channel_mask = (1u << config_.channel_count) - 1;
+        legacy.sampling_rate = config_.sampling_rate;
+        legacy.buffer_size = config_.buffer_size;
+        legacy.trigger_mode = config_.trigger_mode;
+        legacy.trigger_level = config_.trigger_level;
+        groups = &legacy;
+        group_count = 1;
+    }
+    
+    // Group state is left untouched until the configuration is known to be valid
+    if (group_count > MAX_GROUPS || config_.oversampling_bits > MAX_OVERSAMPLING_BITS) {
+        return false;
+    }
+    
+    // Every channel must belong to exactly one group
+    uint32_t assigned = 0;
+    uint32_t max_rate = 0;
+    for (size_t g = 0; g < group_count; g++) {
+        uint32_t mask = groups[g].channel_mask & ((1u << config_.channel_count) - 1);
+        if (mask == 0 || (mask & assigned) || groups[g].sampling_rate == 0) {
+            return false;
+        }
+        assigned |= mask;
+        max_rate = std::max(max_rate, groups[g].sampling_rate);
+    }
+    if (assigned != (1u << config_.channel_count) - 1) {
+        return false;
+    }
+    
+    // Low rates run the ADC at a multiple of the sampling rate and decimate
+    uint32_t adc_sample_freq = (max_rate < 20000) ? 
+        ((20000 + max_rate - 1) / max_rate) * max_rate : 
+        max_rate;
+    
+    // Oversampling needs at least 4^n ADC samples behind every output sample
+    uint32_t oversample_rate = max_rate << (2 * config_.oversampling_bits);
+    adc_sample_freq = std::max(adc_sample_freq, oversample_rate);
+    
+    // Rejected here, a failed adc_continuous_config() would release the ADC handle
+    if (adc_sample_freq > SOC_ADC_SAMPLE_FREQ_THRES_HIGH) {
+        Serial.println("::configure_groups: ADC rate above chip limit");
         return false;
     }
     
-    // Configure trigger
-    trigger_.start(config_.trigger_mode, config_.trigger_level, config_.auto_speed, buffer_size_, buffer_size_ / 2);
+    group_count_ = group_count;
+    adc_sample_freq_ = adc_sample_freq;
+    
+    // Logic ring size is rounded up to whole words
+    logic_size_ = (config_.logic_buffer_size + 31) & ~static_cast<size_t>(31);
+    if (logic_size_ == 0 || logic_size_ > LOGIC_BUFFER_SIZE) {
+        logic_size_ = LOGIC_BUFFER_SIZE;
+    }
+    
+    for (size_t g = 0; g < group_count_; g++) {
+        GroupState& group = groups_[g];
+        
+        // Slower groups decimate the shared ADC stream
+        group.decimation_factor = std::max(static_cast<uint32_t>(1),
+            (adc_sample_freq_ + groups[g].sampling_rate / 2) / groups[g].sampling_rate);
+        group.sampling_rate = adc_sample_freq_ / group.decimation_factor;
+        group.buffer_size = std::min(std::max(groups[g].buffer_size, static_cast<size_t>(1)),
+                                     static_cast<size_t>(SIGNAL_BUFFER_SIZE));
+        group.first_channel = config_.channel_count;
+        group.last_channel = 0;
+        
+        bool all_logic = true;
+        for (size_t i = 0; i < config_.channel_count; i++) {
+            if (groups[g].channel_mask & (1u << i)) {
+                channel_groups_[i] = g;
+                group.first_channel = std::min(group.first_channel, i);
+                group.last_channel = std::max(group.last_channel, i);
+                all_logic = all_logic && is_logic(i);
+            }
+        }
+        
+        // A group of logic channels only captures a whole logic ring per trigger
+        size_t capture_size = all_logic ? logic_size_ : group.buffer_size;
+        
+        // Trigger level is given in 12-bit codes, oversampled samples carry the extra resolution bits
+        uint16_t trigger_level = is_logic(group.first_channel) ?
+            groups[g].trigger_level : groups[g].trigger_level << config_.oversampling_bits;
+        group.trigger.start(groups[g].trigger_mode, trigger_level, config_.auto_speed,
+                            capture_size, capture_size / 2);
+    }
     
+    return true;
+}
+
+void Sigscoper::reset_acquisition() {
     // Reset buffers
     memset(signal_buffers_, 0, sizeof(signal_buffers_));
     memset(buffer_indices_, 0, sizeof(buffer_indices_));
     
-    // Reset trigger
-    trigger_.reset_level();
+    memset(logic_filled_, 0, sizeof(logic_filled_));
+    memset(logic_states_, 0, sizeof(logic_states_));
+    
+    // Reset triggers and decimation
+    for (size_t g = 0; g < group_count_; g++) {
+        groups_[g].trigger.reset_level();
+        groups_[g].sample_counter = 0;
+        groups_[g].averaged_captures = 0;
+        groups_[g].done = false;
+    }
     
     // Reset ready state
     is_ready_ = false;
     
-    // Calculate decimation factor
-    if (config_.sampling_rate < 20000) {
-        decimation_factor_ = ((20000 + config_.sampling_rate - 1) / config_.sampling_rate);
-    } else {
-        decimation_factor_ = 1;
-    }
-    sample_counter_ = 0;
+    // Build raw to millivolt lookup tables
+    build_calibrations();
     
     // Reset median filters
     memset(median_buffers_, 0, sizeof(median_buffers_));
     memset(median_indices_, 0, sizeof(median_indices_));
     memset(median_initialized_, 0, sizeof(median_initialized_));
-
-    running_ = true;
-    stop_requested_ = false;
     
-    // Start the task
-    xSemaphoreGive((SemaphoreHandle_t)start_semaphore_);
+    // Reset oversampling accumulators
+    memset(oversample_sums_, 0, sizeof(oversample_sums_));
+    memset(oversample_counts_, 0, sizeof(oversample_counts_));
     
-    return true;
+    // Exponential averaging weight is rounded to a power of two
+    average_shift_ = 0;
+    while ((1u << average_shift_) < config_.average_count && average_shift_ < 16) {
+        average_shift_++;
+    }
 }
 
 void Sigscoper::restart() {
     running_ = true;
-    stop_requested_ = false;
     is_ready_ = false;
-    trigger_.reset();
+    
+    for (size_t g = 0; g < group_count_; g++) {
+        GroupState& group = groups_[g];
+        
+        // Linear averaging starts a new set, exponential average keeps running
+        if (config_.averaging_mode == AveragingMode::LINEAR) {
+            group.averaged_captures = 0;
+        }
+        group.trigger.reset();
+        reset_logic_history(g);
+    }
+    
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        for (size_t g = 0; g < group_count_; g++) {
+            groups_[g].done = false;
+        }
+        stop_requested_ = false;
+        
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+    
     xSemaphoreGive((SemaphoreHandle_t)start_semaphore_);
 }
 
+void Sigscoper::restart_group(size_t group_index) {
+    if (group_index >= group_count_) {
+        return;
+    }
+    
+    GroupState& group = groups_[group_index];
+    if (!group.done) {
+        return;
+    }
+    
+    if (config_.averaging_mode == AveragingMode::LINEAR) {
+        group.averaged_captures = 0;
+    }
+    group.trigger.reset();
+    reset_logic_history(group_index);
+    is_ready_ = false;
+    
+    // Read loop exits once all groups are done, resume it
+    bool resume = false;
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        group.done = false;
+        resume = running_ && stop_requested_;
+        if (resume) {
+            stop_requested_ = false;
+        }
+        
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+    
+    if (resume) {
+        xSemaphoreGive((SemaphoreHandle_t)start_semaphore_);
+    }
+}
+
+bool Sigscoper::autoset(SigscoperConfig* config, TickType_t timeout) {
+    // Autoset works on the single-group configuration only
+    if (!config || config->channel_count == 0 || config->group_count != 0 ||
+        config->sampling_rate < AUTOSET_MIN_RATE) {
+        return false;
+    }
+    
+    if (running_) {
+        stop();
+    }
+    
+    // Short free-running captures, sampling rate of the config is the upper limit
+    SigscoperConfig probe = *config;
+    probe.trigger_mode = TriggerMode::FREE;
+    probe.averaging_mode = AveragingMode::NONE;
+    probe.mask_action = MaskAction::STOP;
+    probe.buffer_size = std::min(config->buffer_size, static_cast<size_t>(AUTOSET_PROBE_SIZE));
+    
+    uint32_t max_rate = config->sampling_rate;
+    uint32_t rate = max_rate;
+    SigscoperStats stats;
+    TickType_t start_tick = xTaskGetTickCount();
+    bool probed = true;
+    
+    // Probe captures are not production captures, keep them out of mask results
+    masks_enabled_ = false;
+    
+    for (size_t attempt = 0; attempt < AUTOSET_MAX_PROBES; attempt++) {
+        TickType_t elapsed = xTaskGetTickCount() - start_tick;
+        if (timeout != portMAX_DELAY && elapsed >= timeout) {
+            probed = false;
+            break;
+        }
+        
+        probe.sampling_rate = rate;
+        uint32_t generation = capture_generation_;
+        if (!start(probe)) {
+            probed = false;
+            break;
+        }
+        
+        bool captured = wait_for_capture(generation,
+            (timeout == portMAX_DELAY) ? portMAX_DELAY : timeout - elapsed) != 0;
+        if (captured) {
+            captured = get_stats(0, &stats);
+        }
+        stop();
+        
+        if (!captured) {
+            probed = false;
+            break;
+        }
+        
+        uint16_t range = (stats.max_value > stats.min_value) ? stats.max_value - stats.min_value : 0;
+        range >>= config->oversampling_bits;
+        
+        // Flat signal: nothing to fit, keep the fastest rate
+        if (range < AUTOSET_MIN_RANGE) {
+            rate = max_rate;
+            break;
+        }
+        
+        // Too few periods in the probe window: slow down and look again
+        if (stats.frequency <= 0) {
+            if (rate <= AUTOSET_MIN_RATE) {
+                break;
+            }
+            rate = std::max(rate / 8, static_cast<uint32_t>(AUTOSET_MIN_RATE));
+            continue;
+        }
+        
+        // Show a few periods in the final buffer
+        float target = stats.frequency * config->buffer_size / AUTOSET_PERIODS;
+        rate = static_cast<uint32_t>(std::min(std::max(target, static_cast<float>(AUTOSET_MIN_RATE)),
+                                              static_cast<float>(max_rate)));
+        break;
+    }
+    
+    masks_enabled_ = true;
+    if (!probed) {
+        return false;
+    }
+    
+    // Trigger at mid-level, keeping the requested edge direction
+    bool falling = (config->trigger_mode == TriggerMode::AUTO_FALL ||
+                    config->trigger_mode == TriggerMode::FIXED_FALL);
+    config->sampling_rate = rate;
+    if (stats.max_value > stats.min_value + (AUTOSET_MIN_RANGE << config->oversampling_bits)) {
+        config->trigger_mode = falling ? TriggerMode::FIXED_FALL : TriggerMode::FIXED_RISE;
+        config->trigger_level = ((stats.min_value + stats.max_value) / 2) >> config->oversampling_bits;
+    } else {
+        config->trigger_mode = TriggerMode::FREE;
+    }
+    
+    // ADC is reconfigured only if the rate differs from the last probe
+    return start(*config);
+}
+
 void Sigscoper::stop() {
     if (!running_) {
         Serial.println("::stop: Sigscoper is not running");
@@ -234,6 +595,18 @@ void Sigscoper::stop() {
 
 
 bool Sigscoper::get_stats(size_t index, SigscoperStats* stats) const {
+    return calculate_stats(index, nullptr, stats);
+}
+
+bool Sigscoper::get_stats_mv(size_t index, SigscoperStats* stats) const {
+    if (!has_calibration(index)) {
+        return false;
+    }
+    
+    return calculate_stats(index, calibrations_[index], stats);
+}
+
+bool Sigscoper::calculate_stats(size_t index, const Calibration* calibration, SigscoperStats* stats) const {
     if (!stats || index >= config_.channel_count) {
         return false;
     }
@@ -243,16 +616,34 @@ bool Sigscoper::get_stats(size_t index, SigscoperStats* stats) const {
     stats->avg_value = 0;
     stats->frequency = 0;
     
+    if (is_logic(index)) {
+        SigscoperLogicStats logic_stats;
+        if (!get_logic_stats(index, &logic_stats)) {
+            return false;
+        }
+        
+        // Report states as 0/1 levels with duty cycle as average
+        if (logic_stats.samples > 0) {
+            stats->min_value = (logic_stats.duty_cycle < 1.0f) ? 0 : 1;
+            stats->max_value = (logic_stats.duty_cycle > 0.0f) ? 1 : 0;
+        }
+        stats->avg_value = logic_stats.duty_cycle;
+        stats->frequency = logic_stats.frequency;
+        return true;
+    }
+    
     if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
         // Calculate statistics directly from ring buffer
         uint64_t sum = 0;
         uint32_t valid_samples = 0;
-        size_t start_idx = buffer_indices_[index];
+        size_t buffer_size = channel_buffer_size(index);
         
-        for (size_t i = 0; i < buffer_size_; i++) {
-            size_t buf_idx = (start_idx + i) % buffer_size_;
-            uint16_t sample = signal_buffers_[index][buf_idx];
+        for (size_t i = 0; i < buffer_size; i++) {
+            uint16_t sample = get_sample(index, i);
             if (sample > 0) { // Count only valid samples
+                if (calibration) {
+                    sample = calibration->to_mv(sample, config_.oversampling_bits);
+                }
                 if (sample < stats->min_value) stats->min_value = sample;
                 if (sample > stats->max_value) stats->max_value = sample;
                 sum += sample;
@@ -276,59 +667,109 @@ bool Sigscoper::get_stats(size_t index, SigscoperStats* stats) const {
 }
 
 float Sigscoper::calculate_frequency_from_buffer_direct(size_t channel_index) const {
-    if (buffer_size_ < 2) {
-        return 0.0f;
+    return get_cached_measurements(channel_index, MEASURE_FREQUENCY).frequency;
+}
+
+const SigscoperMeasurements& Sigscoper::get_cached_measurements(size_t channel_index, uint32_t mask) const {
+    SigscoperMeasurements& cache = measurement_cache_[channel_index];
+    uint32_t generation = capture_generation_;
+    
+    // Buffer being filled can't be cached
+    bool cacheable = is_ready_ && generation != 0;
+    if (cacheable && measurement_generations_[channel_index] == generation) {
+        if ((cache.valid & mask) == mask) {
+            return cache;
+        }
+        mask |= cache.valid;
+    }
+    
+    measure_channel(channel_index, mask, &cache);
+    measurement_generations_[channel_index] = cacheable ? generation : 0;
+    
+    return cache;
+}
+
+void Sigscoper::measure_channel(size_t channel_index, uint32_t mask, SigscoperMeasurements* result) const {
+    *result = SigscoperMeasurements();
+    result->valid = mask & MEASURE_ALL;
+    
+    size_t buffer_size = channel_buffer_size(channel_index);
+    if (buffer_size < 2) {
+        return;
     }
     
-    // Simple frequency detection algorithm through zero crossing
+    // First pass: level statistics
     uint64_t sum = 0;
+    uint64_t sum_squares = 0;
     uint32_t valid_samples = 0;
-    size_t start_idx = buffer_indices_[channel_index];
+    uint16_t min_val = UINT16_MAX;
+    uint16_t max_val = 0;
     
-    // Calculate average value
-    for (size_t i = 0; i < buffer_size_; i++) {
-        size_t buf_idx = (start_idx + i) % buffer_size_;
-        uint16_t sample = signal_buffers_[channel_index][buf_idx];
+    for (size_t i = 0; i < buffer_size; i++) {
+        uint16_t sample = get_sample(channel_index, i);
         if (sample > 0) {
+            if (sample < min_val) min_val = sample;
+            if (sample > max_val) max_val = sample;
             sum += sample;
+            sum_squares += static_cast<uint32_t>(sample) * sample;
             valid_samples++;
         }
     }
     
     if (valid_samples == 0) {
-        return 0.0f;
+        return;
     }
     
     float avg_value = static_cast<float>(sum) / valid_samples;
+    result->rms = sqrtf(static_cast<float>(sum_squares) / valid_samples);
+    result->peak_to_peak = max_val - min_val;
     
-    // Find min and max for hysteresis calculation
-    uint16_t min_val = UINT16_MAX;
-    uint16_t max_val = 0;
-    
-    for (size_t i = 0; i < buffer_size_; i++) {
-        size_t buf_idx = (start_idx + i) % buffer_size_;
-        uint16_t sample = signal_buffers_[channel_index][buf_idx];
-        if (sample > 0) {
-            if (sample < min_val) min_val = sample;
-            if (sample > max_val) max_val = sample;
-        }
+    const uint32_t crossing_mask = MEASURE_FREQUENCY | MEASURE_DUTY_CYCLE | MEASURE_RISE_TIME |
+                                   MEASURE_FALL_TIME | MEASURE_OVERSHOOT | MEASURE_JITTER;
+    if (!(mask & crossing_mask)) {
+        return;
     }
     
+    // Second pass: crossings through average value with hysteresis
     uint16_t signal_range = (max_val > min_val) ? (max_val - min_val) : 0;
     uint16_t hysteresis = signal_range / 5;
     float upper_threshold = avg_value + hysteresis / 2.0;
     float lower_threshold = avg_value - hysteresis / 2.0;
     
-    // Count crossings through average value
+    // 10% and 90% levels for transition times
+    float low_level = min_val + signal_range * 0.1f;
+    float high_level = min_val + signal_range * 0.9f;
+    
     bool signal_was_high = false;
+    bool state_known = false;
     uint32_t crossing_count = 0;
     uint64_t total_delta = 0;
+    uint64_t total_delta_squares = 0;
+    uint32_t delta_count = 0;
     uint32_t last_crossing_index = 0;
     
-    for (size_t i = 0; i < buffer_size_; i++) {
-        size_t buf_idx = (start_idx + i) % buffer_size_;
-        uint16_t sample = signal_buffers_[channel_index][buf_idx];
+    uint32_t high_samples = 0;
+    uint64_t high_sum = 0;
+    uint64_t low_sum = 0;
+    
+    bool at_high_level = false;
+    bool level_known = false;
+    uint32_t last_low_index = 0;
+    uint32_t last_high_index = 0;
+    uint64_t total_rise = 0;
+    uint64_t total_fall = 0;
+    uint32_t rise_count = 0;
+    uint32_t fall_count = 0;
+    
+    for (size_t i = 0; i < buffer_size; i++) {
+        uint16_t sample = get_sample(channel_index, i);
         if (sample > 0) {
+            // Start from the level of the first sample so that only real edges open a period
+            if (!state_known) {
+                signal_was_high = sample > avg_value;
+                state_known = true;
+            }
+            
             if (!signal_was_high && sample > upper_threshold) {
                 signal_was_high = true;
                 
@@ -336,6 +777,8 @@ float Sigscoper::calculate_frequency_from_buffer_direct(size_t channel_index) co
                     uint32_t delta = i - last_crossing_index;
                     if (delta >= 4) { // Minimum 200 μs between transitions at 20kHz
                         total_delta += delta;
+                        total_delta_squares += static_cast<uint64_t>(delta) * delta;
+                        delta_count++;
                     }
                 }
                 last_crossing_index = i;
@@ -343,38 +786,79 @@ float Sigscoper::calculate_frequency_from_buffer_direct(size_t channel_index) co
             } else if (signal_was_high && sample < lower_threshold) {
                 signal_was_high = false;
             }
+            
+            if (signal_was_high) {
+                high_samples++;
+                high_sum += sample;
+            } else {
+                low_sum += sample;
+            }
+            
+            // Transition time is from the last sample beyond one level to the first beyond the other
+            if (sample <= low_level) {
+                if (level_known && at_high_level) {
+                    total_fall += i - last_high_index;
+                    fall_count++;
+                }
+                at_high_level = false;
+                level_known = true;
+                last_low_index = i;
+            } else if (sample >= high_level) {
+                if (level_known && !at_high_level) {
+                    total_rise += i - last_low_index;
+                    rise_count++;
+                }
+                at_high_level = true;
+                level_known = true;
+                last_high_index = i;
+            }
         }
     }
     
-    // Calculate frequency with decimation consideration
+    // Consider decimation: effective sampling rate
+    float effective_sample_rate = static_cast<float>(channel_rate(channel_index));
+    
     if (crossing_count > 1 && total_delta > 0) {
         float avg_delta = static_cast<float>(total_delta) / (crossing_count - 1);
         if (avg_delta > 0) {
-            // Consider decimation: effective sampling rate
-            float effective_sample_rate = static_cast<float>(config_.sampling_rate);
-            return effective_sample_rate / avg_delta;
+            result->frequency = effective_sample_rate / avg_delta;
         }
     }
     
-    return 0.0f;
+    // Standard deviation of accepted periods
+    if (delta_count > 1) {
+        float mean = static_cast<float>(total_delta) / delta_count;
+        float variance = static_cast<float>(total_delta_squares) / delta_count - mean * mean;
+        result->period_jitter = (variance > 0) ? sqrtf(variance) / effective_sample_rate : 0;
+    }
+    
+    result->duty_cycle = static_cast<float>(high_samples) / valid_samples;
+    
+    if (rise_count > 0) {
+        result->rise_time = static_cast<float>(total_rise) / rise_count / effective_sample_rate;
+    }
+    if (fall_count > 0) {
+        result->fall_time = static_cast<float>(total_fall) / fall_count / effective_sample_rate;
+    }
+    
+    // Overshoot relative to the settled high and low levels
+    uint32_t low_samples = valid_samples - high_samples;
+    if (high_samples > 0 && low_samples > 0) {
+        float high_mean = static_cast<float>(high_sum) / high_samples;
+        float low_mean = static_cast<float>(low_sum) / low_samples;
+        if (high_mean > low_mean && max_val > high_mean) {
+            result->overshoot = (max_val - high_mean) / (high_mean - low_mean) * 100.0f;
+        }
+    }
 }
 
-bool Sigscoper::get_buffer(size_t index, size_t size, uint16_t* buffer, size_t* position) const {
-    if (!buffer || index >= config_.channel_count || size == 0) {
+bool Sigscoper::get_measurements(size_t index, uint32_t mask, SigscoperMeasurements* measurements) const {
+    if (!measurements || index >= config_.channel_count || is_logic(index)) {
         return false;
     }
     
     if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
-        size_t copy_size = (size < buffer_size_) ? size : buffer_size_;
-        size_t start_idx = buffer_indices_[index];
-        
-        // Copy data from ring buffer
-        for (size_t i = 0; i < copy_size; i++) {
-            size_t buf_idx = (start_idx + i) % buffer_size_;
-            buffer[i] = signal_buffers_[index][buf_idx];
-        }
-
-        *position = start_idx;
+        *measurements = get_cached_measurements(index, mask);
         
         xSemaphoreGive((SemaphoreHandle_t)mutex_);
         return true;
@@ -383,84 +867,681 @@ bool Sigscoper::get_buffer(size_t index, size_t size, uint16_t* buffer, size_t*
     return false;
 }
 
-void Sigscoper::read_task_wrapper(void* parameter) {
-    Sigscoper* signal = static_cast<Sigscoper*>(parameter);
-    signal->read_task();
-}
-
-void Sigscoper::read_task() {
-    uint8_t adc_read_buffer[CONV_FRAME_SIZE];
-    uint32_t total_sample_count = 0;
+bool Sigscoper::calculate_lag(size_t a, size_t b, size_t max_lag, float* lag) const {
+    size_t n = channel_buffer_size(a);
+    float* work = new (std::nothrow) float[2 * n];
+    if (!work) {
+        return false;
+    }
+    float* x = work;
+    float* y = work + n;
     
-    while (true) {
-        // Wait for signal to start work
-        xSemaphoreTake((SemaphoreHandle_t)start_semaphore_, portMAX_DELAY);
+    // Copy both channels so the read task is not blocked during correlation
+    float frequency = 0;
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        for (size_t i = 0; i < n; i++) {
+            x[i] = get_sample(a, i);
+            y[i] = get_sample(b, i);
+        }
+        frequency = calculate_frequency_from_buffer_direct(a);
         
-        // Reset counter on each start
-        total_sample_count = 0;
-        trigger_.reset();
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    } else {
+        delete[] work;
+        return false;
+    }
+    
+    // Remove DC so the correlation peak follows the waveform shape
+    float mean_x = 0;
+    float mean_y = 0;
+    for (size_t i = 0; i < n; i++) {
+        mean_x += x[i];
+        mean_y += y[i];
+    }
+    mean_x /= n;
+    mean_y /= n;
+    for (size_t i = 0; i < n; i++) {
+        x[i] -= mean_x;
+        y[i] -= mean_y;
+    }
+    
+    // Default window is one period, enough to find the nearest peak
+    if (max_lag == 0) {
+        max_lag = (frequency > 0) ? static_cast<size_t>(channel_rate(a) / frequency) : n / 4;
+    }
+    if (max_lag > n / 2) {
+        max_lag = n / 2;
+    }
+    int32_t window = static_cast<int32_t>(max_lag);
+    
+    // Cross-correlation normalized by overlap length, y[i + k] against x[i]
+    float best = -INFINITY;
+    float before = 0;
+    float after = 0;
+    float previous = 0;
+    int32_t best_lag = 0;
+    bool take_next = false;
+    
+    for (int32_t k = -window; k <= window; k++) {
+        size_t start = (k < 0) ? -k : 0;
+        size_t end = (k > 0) ? n - k : n;
+        const float* shifted = y + k;
         
-        while (!stop_requested_) {
-            uint32_t current_bytes_read;
-            
-            esp_err_t ret = adc_continuous_read(adc_handle_, adc_read_buffer, 
-                                              CONV_FRAME_SIZE, &current_bytes_read, 100);
-            
-            if (ret == ESP_OK && current_bytes_read > 0) {
-                int samples_read = current_bytes_read / SOC_ADC_DIGI_RESULT_BYTES;
-                
-                for (int i = 0; i < samples_read; i++) {
-                    adc_digi_output_data_t *p = (adc_digi_output_data_t*)
-                        &adc_read_buffer[i * SOC_ADC_DIGI_RESULT_BYTES];
-                    
-                    // Find channel index
-                    size_t channel_index = config_.channel_count;
-                    for (size_t j = 0; j < config_.channel_count; j++) {
-                        if (config_.channels[j] == p->type1.channel) {
-                            channel_index = j;
-                            break;
-                        }
-                    }
-                    
-                    if (channel_index < config_.channel_count) {
-                        uint16_t current_sample = p->type1.data;
-                        uint16_t filtered_sample = apply_median_filter(channel_index, current_sample);
-                        
-                        // Decimation: process only every N-th sample
-                        // Update sample counter only for the first channel to synchronize all channels
-                        if (channel_index == 0) {
-                            sample_counter_++;
-                        }
-                        
-                        if (sample_counter_ >= decimation_factor_) {
-                            // Check trigger only for first channel on decimated samples
-                            if (channel_index == 0) {
-                                TriggerState state = trigger_.check_trigger(filtered_sample);
-                                
-                                // If buffer is ready, set flag
-                                if (state.buffer_ready) {
-                                    is_ready_ = true;
-                                }
-                                
-                                // If need to stop work
-                                if (!state.continue_work) {
-                                    stop_requested_ = true;
-                                    break; // Exit reading loop
-                                }
-                            }
-                            
-                            process_sample(channel_index, filtered_sample);
-                            
-                            // Reset sample counter only after processing the last channel
-                            if (channel_index == config_.channel_count - 1) {
-                                sample_counter_ = 0;
-                            }
-                        }
-                        total_sample_count++;
-                    }
+        float acc = 0;
+        for (size_t i = start; i < end; i++) {
+            acc += x[i] * shifted[i];
+        }
+        acc /= (end - start);
+        
+        if (take_next) {
+            after = acc;
+            take_next = false;
+        }
+        if (acc > best) {
+            best = acc;
+            best_lag = k;
+            before = previous;
+            after = acc;
+            take_next = true;
+        }
+        previous = acc;
+    }
+    
+    delete[] work;
+    
+    if (!(best > 0)) {
+        return false;
+    }
+    
+    // Parabolic interpolation around the peak for sub-sample precision
+    float offset = 0;
+    if (best_lag > -window && best_lag < window) {
+        float denominator = before - 2 * best + after;
+        if (denominator < 0) {
+            offset = 0.5f * (before - after) / denominator;
+        }
+    }
+    
+    *lag = best_lag + offset;
+    return true;
+}
+
+bool Sigscoper::get_delay(size_t a, size_t b, float* delay, size_t max_lag) const {
+    if (!delay || a >= config_.channel_count || b >= config_.channel_count ||
+        is_logic(a) || is_logic(b) || channel_buffer_size(a) < 4) {
+        return false;
+    }
+    
+    // Only channels sampled at the same rate can be correlated
+    if (channel_groups_[a] != channel_groups_[b]) {
+        return false;
+    }
+    
+    float lag = 0;
+    if (!calculate_lag(a, b, max_lag, &lag)) {
+        return false;
+    }
+    
+    // Timing model of the whole library: every channel is sampled at the ADC rate (one full pattern
+    // per ADC period, see channel_rate()), so adjacent pattern entries are 1/(channels * rate) apart
+    float pattern_rate = static_cast<float>(get_adc_sample_freq()) * config_.channel_count;
+    float skew = static_cast<float>(static_cast<int32_t>(b) - static_cast<int32_t>(a)) / pattern_rate;
+    *delay = lag / channel_rate(a) + skew;
+    
+    return true;
+}
+
+bool Sigscoper::get_phase(size_t a, size_t b, float* phase, size_t max_lag) const {
+    if (!phase) {
+        return false;
+    }
+    
+    float delay = 0;
+    if (!get_delay(a, b, &delay, max_lag)) {
+        return false;
+    }
+    
+    SigscoperMeasurements measurements;
+    if (!get_measurements(a, MEASURE_FREQUENCY, &measurements) || measurements.frequency <= 0) {
+        return false;
+    }
+    
+    // Wrap to (-180, 180]
+    float degrees = fmodf(delay * measurements.frequency * 360.0f, 360.0f);
+    if (degrees > 180.0f) {
+        degrees -= 360.0f;
+    } else if (degrees <= -180.0f) {
+        degrees += 360.0f;
+    }
+    *phase = degrees;
+    
+    return true;
+}
+
+bool Sigscoper::get_buffer(size_t index, size_t size, uint16_t* buffer, size_t* position) const {
+    if (!buffer || index >= config_.channel_count || size == 0) {
+        return false;
+    }
+    
+    if (is_logic(index)) {
+        // Unpack states as 0/1 samples, oldest first
+        if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+            size_t copy_size = (size < logic_size_) ? size : logic_size_;
+            size_t start_idx = buffer_indices_[index];
+            
+            for (size_t i = 0; i < copy_size; i++) {
+                size_t bit_idx = (start_idx + i) % logic_size_;
+                buffer[i] = (signal_buffers_[index].bits[bit_idx / 32] >> (bit_idx % 32)) & 1;
+            }
+            
+            *position = start_idx;
+            
+            xSemaphoreGive((SemaphoreHandle_t)mutex_);
+            return true;
+        }
+        
+        return false;
+    }
+    
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        size_t buffer_size = channel_buffer_size(index);
+        size_t copy_size = (size < buffer_size) ? size : buffer_size;
+        size_t start_idx = buffer_indices_[index];
+        
+        // Copy data from ring buffer
+        for (size_t i = 0; i < copy_size; i++) {
+            buffer[i] = get_sample(index, i);
+        }
+
+        // Averaged data is stored oldest first
+        *position = is_averaged(index) ? 0 : start_idx;
+        
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+        return true;
+    }
+    
+    return false;
+}
+
+bool Sigscoper::set_mask(size_t index, const uint16_t* lower, const uint16_t* upper, size_t length) {
+    if (index >= MAX_CHANNELS || !lower || !upper || length == 0 || length > SIGNAL_BUFFER_SIZE || !mutex_) {
+        return false;
+    }
+    
+    for (size_t i = 0; i < length; i++) {
+        if (lower[i] > upper[i]) {
+            Serial.println("::set_mask: lower mask above upper mask");
+            return false;
+        }
+    }
+    
+    // Allocated here so that testing never allocates at capture rate
+    uint16_t* storage = new (std::nothrow) uint16_t[length * 3]();
+    if (!storage) {
+        Serial.println("::set_mask: failed to allocate mask");
+        return false;
+    }
+    memcpy(storage, lower, length * sizeof(uint16_t));
+    memcpy(&storage[length], upper, length * sizeof(uint16_t));
+    
+    uint16_t* previous = nullptr;
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        MaskState& mask = masks_[index];
+        previous = mask.lower;
+        mask.lower = storage;
+        mask.upper = &storage[length];
+        mask.failure = &storage[length * 2];
+        mask.length = length;
+        mask.result = SigscoperMaskResult();
+        
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+    
+    delete[] previous;
+    return true;
+}
+
+void Sigscoper::clear_mask(size_t index) {
+    if (index >= MAX_CHANNELS || !mutex_) {
+        return;
+    }
+    
+    uint16_t* previous = nullptr;
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        MaskState& mask = masks_[index];
+        previous = mask.lower;
+        mask.lower = nullptr;
+        mask.upper = nullptr;
+        mask.failure = nullptr;
+        mask.length = 0;
+        mask.result = SigscoperMaskResult();
+        
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+    
+    delete[] previous;
+}
+
+void Sigscoper::reset_mask_result(size_t index) {
+    if (index >= MAX_CHANNELS || !mutex_) {
+        return;
+    }
+    
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        masks_[index].result = SigscoperMaskResult();
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+}
+
+bool Sigscoper::get_mask_result(size_t index, SigscoperMaskResult* result) const {
+    if (index >= MAX_CHANNELS || !result || !masks_[index].lower) {
+        return false;
+    }
+    
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        *result = masks_[index].result;
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+        return true;
+    }
+    
+    return false;
+}
+
+bool Sigscoper::get_mask_failure(size_t index, size_t size, uint16_t* buffer) const {
+    if (index >= MAX_CHANNELS || !buffer) {
+        return false;
+    }
+    
+    bool result = false;
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        const MaskState& mask = masks_[index];
+        if (mask.lower && mask.result.has_failure) {
+            memcpy(buffer, mask.failure, std::min(size, mask.length) * sizeof(uint16_t));
+            result = true;
+        }
+        
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+    
+    return result;
+}
+
+bool Sigscoper::has_calibration(size_t index) const {
+    return index < config_.channel_count && calibrations_[index] != nullptr;
+}
+
+bool Sigscoper::get_buffer_mv(size_t index, size_t size, uint16_t* buffer, size_t* position) const {
+    if (!has_calibration(index)) {
+        return false;
+    }
+    
+    if (!get_buffer(index, size, buffer, position)) {
+        return false;
+    }
+    
+    // Convert the whole block in place, one table lookup per sample
+    size_t copy_size = std::min(size, channel_buffer_size(index));
+    calibrations_[index]->convert(buffer, buffer, copy_size, config_.oversampling_bits);
+    
+    return true;
+}
+
+void Sigscoper::build_calibrations() {
+    for (size_t i = 0; i < MAX_CHANNELS; i++) {
+        calibrations_[i] = nullptr;
+    }
+    
+    for (size_t i = 0; i < config_.channel_count; i++) {
+        const ChannelCalibration& calibration = config_.calibration[i];
+        
+        // Logic channels store states, not voltages
+        if (is_logic(i)) {
+            continue;
+        }
+        
+        switch (calibration.mode) {
+            case CalibrationMode::ADC_CALI: {
+#if SOC_ADC_CALIB_CHAN_COMPENS_SUPPORTED
+                // Curve fitting compensates every channel separately, one table per channel
+                Calibration& table = channel_calibrations_[i];
+                adc_channel_t channel = config_.channels[i];
+#else
+                // Characterization depends only on unit and attenuation, one shared table
+                Calibration& table = adc_calibration_;
+                adc_channel_t channel = ADC_CHANNEL_0;
+#endif
+                // Tables are rebuilt only when their source changes
+                if (!table.is_adc_cali(channel)) {
+                    table.build_adc_cali(ADC_UNIT_1, ADC_ATTEN_DB_12, channel);
+                }
+                if (table.is_valid()) {
+                    calibrations_[i] = &table;
+                }
+                break;
+            }
+                
+            case CalibrationMode::POINTS:
+                if (channel_calibrations_[i].build_points(calibration.points, calibration.point_count)) {
+                    calibrations_[i] = &channel_calibrations_[i];
+                } else {
+                    Serial.println("::start: invalid calibration points");
                 }
+                break;
+                
+            case CalibrationMode::NONE:
+            default:
+                break;
+        }
+    }
+}
+
+bool Sigscoper::allocate_accumulators() {
+    if (config_.averaging_mode == AveragingMode::NONE) {
+        return true;
+    }
+    
+    if (config_.average_count == 0) {
+        return false;
+    }
+    
+    // Linear sums of full-scale samples must fit the 32-bit accumulators
+    uint32_t max_sample = (4096u << config_.oversampling_bits) - 1;
+    if (config_.averaging_mode == AveragingMode::LINEAR && config_.average_count > INT32_MAX / max_sample) {
+        Serial.println("::allocate_accumulators: average_count too large");
+        return false;
+    }
+    
+    // Accumulators are reused by later captures and starts
+    size_t required = 0;
+    for (size_t ch = 0; ch < config_.channel_count; ch++) {
+        accumulator_offsets_[ch] = required;
+        required += channel_buffer_size(ch);
+    }
+    if (required > accumulators_capacity_) {
+        delete[] accumulators_;
+        accumulators_ = new (std::nothrow) int32_t[required];
+        accumulators_capacity_ = accumulators_ ? required : 0;
+    }
+    
+    return accumulators_ != nullptr;
+}
+
+bool Sigscoper::complete_capture(size_t group_index) {
+    bool failed = false;
+    bool tested = test_masks(group_index, &failed);
+    bool ready = accumulate_capture(group_index);
+    
+    if (!tested) {
+        return ready;
+    }
+    
+    // Screening re-arms the trigger like linear averaging, without signalling captures
+    bool stop = ready;
+    if (config_.mask_action == MaskAction::REARM) {
+        stop = false;
+    } else if (config_.mask_action == MaskAction::REARM_UNTIL_FAIL) {
+        stop = failed;
+    }
+    
+    // A completed linear average that is not shown starts over instead of overflowing
+    if (ready && !stop && config_.averaging_mode == AveragingMode::LINEAR) {
+        groups_[group_index].averaged_captures = 0;
+    }
+    
+    return stop;
+}
+
+bool Sigscoper::test_masks(size_t group_index, bool* failed) {
+    bool tested = false;
+    
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        for (size_t ch = 0; ch < config_.channel_count; ch++) {
+            MaskState& mask = masks_[ch];
+            if (!masks_enabled_ || !mask.lower || is_logic(ch) || channel_groups_[ch] != group_index) {
+                continue;
+            }
+            
+            // Raw capture, ring unrolled into two contiguous segments, oldest sample first
+            const uint16_t* samples = signal_buffers_[ch].samples;
+            size_t length = std::min(mask.length, groups_[group_index].buffer_size);
+            size_t start_idx = buffer_indices_[ch];
+            size_t tail = std::min(groups_[group_index].buffer_size - start_idx, length);
+            size_t head = length - tail;
+            
+            // Branchless count of samples outside the envelope
+            size_t violations = 0;
+            for (size_t i = 0; i < tail; i++) {
+                uint16_t sample = samples[start_idx + i];
+                violations += (sample < mask.lower[i]) | (sample > mask.upper[i]);
+            }
+            for (size_t i = 0; i < head; i++) {
+                uint16_t sample = samples[i];
+                violations += (sample < mask.lower[tail + i]) | (sample > mask.upper[tail + i]);
+            }
+            
+            if (violations == 0) {
+                mask.result.passed++;
+            } else {
+                mask.result.failed++;
+                *failed = true;
                 
+                // Keep only the first failure for inspection
+                if (!mask.result.has_failure) {
+                    memcpy(mask.failure, &samples[start_idx], tail * sizeof(uint16_t));
+                    memcpy(&mask.failure[tail], samples, head * sizeof(uint16_t));
+                    mask.result.has_failure = true;
+                    mask.result.failure_violations = violations;
+                }
+            }
+            
+            tested = true;
+        }
+        
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+    
+    return tested;
+}
+
+bool Sigscoper::accumulate_capture(size_t group_index) {
+    if (config_.averaging_mode == AveragingMode::NONE) {
+        return true;
+    }
+    
+    GroupState& group = groups_[group_index];
+    
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        bool first = (group.averaged_captures == 0);
+        bool exponential = (config_.averaging_mode == AveragingMode::EXPONENTIAL);
+        
+        for (size_t ch = 0; ch < config_.channel_count; ch++) {
+            if (is_logic(ch) || channel_groups_[ch] != group_index) {
+                continue;
+            }
+            
+            // Ring is unrolled into two contiguous segments, oldest sample first
+            int32_t* acc = &accumulators_[accumulator_offsets_[ch]];
+            const uint16_t* samples = signal_buffers_[ch].samples;
+            size_t start_idx = buffer_indices_[ch];
+            size_t tail = group.buffer_size - start_idx;
+            
+            if (first) {
+                // Exponential average is kept in 24.8 fixed point
+                int shift = exponential ? 8 : 0;
+                for (size_t i = 0; i < tail; i++) acc[i] = samples[start_idx + i] << shift;
+                for (size_t i = 0; i < start_idx; i++) acc[tail + i] = samples[i] << shift;
+            } else if (exponential) {
+                for (size_t i = 0; i < tail; i++) {
+                    acc[i] += ((samples[start_idx + i] << 8) - acc[i]) >> average_shift_;
+                }
+                for (size_t i = 0; i < start_idx; i++) {
+                    acc[tail + i] += ((samples[i] << 8) - acc[tail + i]) >> average_shift_;
+                }
+            } else {
+                for (size_t i = 0; i < tail; i++) acc[i] += samples[start_idx + i];
+                for (size_t i = 0; i < start_idx; i++) acc[tail + i] += samples[i];
+            }
+        }
+        
+        group.averaged_captures++;
+        
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+    
+    // Linear average is ready after N captures, exponential after every capture
+    return config_.averaging_mode == AveragingMode::EXPONENTIAL ||
+           group.averaged_captures >= config_.average_count;
+}
+
+uint16_t Sigscoper::get_sample(size_t channel_index, size_t i) const {
+    if (is_averaged(channel_index)) {
+        int32_t acc = accumulators_[accumulator_offsets_[channel_index] + i];
+        if (config_.averaging_mode == AveragingMode::EXPONENTIAL) {
+            return static_cast<uint16_t>((acc + 128) >> 8);
+        }
+        uint32_t count = groups_[channel_groups_[channel_index]].averaged_captures;
+        return static_cast<uint16_t>((acc + count / 2) / count);
+    }
+    
+    return signal_buffers_[channel_index].samples[(buffer_indices_[channel_index] + i) % channel_buffer_size(channel_index)];
+}
+
+uint32_t Sigscoper::next_generation(uint32_t generation) {
+    // 0 means "no capture yet" and is skipped on wraparound
+    generation++;
+    return (generation == 0) ? 1 : generation;
+}
 
+void Sigscoper::signal_capture() {
+    capture_generation_ = next_generation(capture_generation_);
+    
+    // Generation is published first so cached measurements of the previous capture are never reused
+    is_ready_ = true;
+    notify_waiters();
+}
+
+void Sigscoper::notify_waiters() {
+    // Wake every registered waiter, each one checks the generation itself
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        for (size_t i = 0; i < MAX_CAPTURE_WAITERS; i++) {
+            if (capture_waiters_[i]) {
+                xTaskNotifyGive(capture_waiters_[i]);
+            }
+        }
+        
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+}
+
+uint32_t Sigscoper::wait_for_capture(uint32_t newer_than, TickType_t timeout) {
+    return wait_for_generation(capture_generation_, newer_than, timeout);
+}
+
+uint32_t Sigscoper::wait_for_group(size_t group_index, uint32_t newer_than, TickType_t timeout) {
+    if (group_index >= group_count_) {
+        return 0;
+    }
+    
+    return wait_for_generation(groups_[group_index].generation, newer_than, timeout);
+}
+
+uint32_t Sigscoper::wait_for_generation(const std::atomic<uint32_t>& counter, uint32_t newer_than,
+                                        TickType_t timeout) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    size_t slot = MAX_CAPTURE_WAITERS;
+    
+    // Register before checking the generation so that no notification is lost
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        for (size_t i = 0; i < MAX_CAPTURE_WAITERS; i++) {
+            if (!capture_waiters_[i]) {
+                capture_waiters_[i] = self;
+                slot = i;
+                break;
+            }
+        }
+        
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+    
+    if (slot == MAX_CAPTURE_WAITERS) {
+        Serial.println("::wait_for_generation: too many waiters");
+        return 0;
+    }
+    
+    TickType_t start_tick = xTaskGetTickCount();
+    uint32_t generation = counter;
+    
+    // Generations are compared with wraparound
+    while (generation == 0 || static_cast<int32_t>(generation - newer_than) <= 0) {
+        TickType_t elapsed = xTaskGetTickCount() - start_tick;
+        if (timeout != portMAX_DELAY && elapsed >= timeout) {
+            generation = 0;
+            break;
+        }
+        
+        ulTaskNotifyTake(pdTRUE, (timeout == portMAX_DELAY) ? portMAX_DELAY : timeout - elapsed);
+        generation = counter;
+    }
+    
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        capture_waiters_[slot] = nullptr;
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+    
+    return generation;
+}
+
+void Sigscoper::update_trend() {
+    if (!trend_) {
+        return;
+    }
+    
+    uint32_t now_ms = millis();
+    for (size_t i = 0; i < config_.channel_count; i++) {
+        SigscoperStats stats;
+        if (get_stats(i, &stats)) {
+            trend_->update(i, stats, now_ms);
+        }
+    }
+}
+
+void Sigscoper::read_task_wrapper(void* parameter) {
+    Sigscoper* signal = static_cast<Sigscoper*>(parameter);
+    signal->read_task();
+}
+
+void Sigscoper::read_task() {
+    uint8_t adc_read_buffer[CONV_FRAME_SIZE];
+    
+    while (true) {
+        // Wait for signal to start work
+        xSemaphoreTake((SemaphoreHandle_t)start_semaphore_, portMAX_DELAY);
+        
+        // Stale start signal after stop(), acquisition state may belong to replay()
+        task_active_ = true;
+        if (!running_) {
+            task_active_ = false;
+            continue;
+        }
+        
+        for (size_t g = 0; g < group_count_; g++) {
+            if (!groups_[g].done) {
+                groups_[g].trigger.reset();
+            }
+        }
+        
+        while (running_ && !stop_requested_) {
+            uint32_t current_bytes_read;
+            
+            esp_err_t ret = adc_continuous_read(adc_handle_, adc_read_buffer, 
+                                              CONV_FRAME_SIZE, &current_bytes_read, 100);
+            
+            if (ret == ESP_OK && current_bytes_read > 0) {
+                if (recorder_ && recorder_->is_recording()) {
+                    recorder_->record(adc_read_buffer, current_bytes_read, micros());
+                }
+                
+                process_frame(adc_read_buffer, current_bytes_read);
             } else if (ret == ESP_ERR_TIMEOUT) {
                 // Normal timeout, continue
                 continue;
@@ -469,23 +1550,340 @@ void Sigscoper::read_task() {
                 vTaskDelay(pdMS_TO_TICKS(10));
             }
         }
+        
+        task_active_ = false;
     }
 }
 
+void Sigscoper::process_frame(const uint8_t* data, size_t size) {
+    int samples_read = size / SOC_ADC_DIGI_RESULT_BYTES;
+    
+    for (int i = 0; i < samples_read; i++) {
+        const adc_digi_output_data_t *p = (const adc_digi_output_data_t*)
+            &data[i * SOC_ADC_DIGI_RESULT_BYTES];
+        
+        // Find channel index
+        size_t channel_index = config_.channel_count;
+        for (size_t j = 0; j < config_.channel_count; j++) {
+            if (config_.channels[j] == p->type1.channel) {
+                channel_index = j;
+                break;
+            }
+        }
+        
+        if (channel_index < config_.channel_count) {
+            uint16_t current_sample = p->type1.data;
+            bool oversampled = config_.oversampling_bits > 0 && !is_logic(channel_index);
+            uint16_t filtered_sample = (is_logic(channel_index) || oversampled) ?
+                current_sample : apply_median_filter(channel_index, current_sample);
+            
+            // Groups that completed their capture don't record until restarted
+            GroupState& group = groups_[channel_groups_[channel_index]];
+            if (group.done) {
+                continue;
+            }
+            
+            // Oversampling sums every ADC sample instead of median filtering
+            if (oversampled) {
+                oversample_sums_[channel_index] += current_sample;
+                oversample_counts_[channel_index]++;
+            }
+            
+            // Decimation: process only every N-th sample
+            // Update sample counter only for the first channel of the group to synchronize its channels
+            if (channel_index == group.first_channel) {
+                group.sample_counter++;
+            }
+            
+            if (group.sample_counter >= group.decimation_factor) {
+                if (oversampled) {
+                    filtered_sample = take_oversampled(channel_index);
+                }
+                
+                // Check trigger only for first channel of the group on decimated samples
+                if (channel_index == group.first_channel) {
+                    TriggerState state = group.trigger.check_trigger(filtered_sample);
+                    
+                    // If buffer is ready, complete the group capture
+                    if (state.buffer_ready && !complete_capture(channel_groups_[channel_index])) {
+                        // Averaging needs more captures, re-arm without stopping
+                        group.trigger.reset();
+                        state.continue_work = true;
+                    }
+                    
+                    // If need to stop work
+                    if (!state.continue_work) {
+                        finish_group(channel_groups_[channel_index]);
+                        if (stop_requested_) {
+                            break; // Exit reading loop
+                        }
+                        continue;
+                    }
+                }
+                
+                process_sample(channel_index, filtered_sample);
+                
+                // Reset sample counter only after processing the last channel of the group
+                if (channel_index == group.last_channel) {
+                    group.sample_counter = 0;
+                }
+            }
+        }
+    }
+}
 
+void Sigscoper::finish_group(size_t group_index) {
+    groups_[group_index].sample_counter = 0;
+    
+    // Partial oversampling sums must not leak into the next capture
+    for (size_t i = 0; i < config_.channel_count; i++) {
+        if (channel_groups_[i] == group_index) {
+            oversample_sums_[i] = 0;
+            oversample_counts_[i] = 0;
+        }
+    }
+    
+    // Completion and the stop request are published together, so a restart never sees one without the other
+    bool all_done = true;
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        groups_[group_index].done = true;
+        for (size_t g = 0; g < group_count_; g++) {
+            all_done = all_done && groups_[g].done;
+        }
+        if (all_done) {
+            stop_requested_ = true;
+        }
+        
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+    
+    if (all_done) {
+        update_trend();
+    }
+    
+    // Waiters are woken last, they may restart acquisition right away
+    groups_[group_index].generation = next_generation(groups_[group_index].generation);
+    if (all_done) {
+        signal_capture();
+    } else {
+        notify_waiters();
+    }
+}
+
+bool Sigscoper::replay(const SigscoperConfig& config, const Recorder& recorder, size_t* cursor) {
+    if (running_) {
+        Serial.println("::replay: Sigscoper already run");
+        return false;
+    }
+    
+    // Check configuration
+    if (config.channel_count == 0 || config.channel_count > MAX_CHANNELS) {
+        return false;
+    }
+    
+    wait_for_task_idle();
+    
+    // Same state as start() but without touching the ADC
+    config_ = config;
+    if (!configure_groups() || !allocate_accumulators()) {
+        return false;
+    }
+    reset_acquisition();
+    stop_requested_ = false;
+    
+    // Feed recorded frames as fast as possible until the capture completes
+    uint8_t frame[CONV_FRAME_SIZE];
+    size_t position = cursor ? *cursor : 0;
+    size_t frame_size = 0;
+    
+    while (!stop_requested_ &&
+           recorder.next_frame(&position, frame, sizeof(frame), &frame_size, nullptr)) {
+        process_frame(frame, frame_size);
+    }
+    
+    if (cursor) {
+        *cursor = position;
+    }
+    
+    stop_requested_ = false;
+    return is_ready_;
+}
 
 void Sigscoper::process_sample(size_t channel_index, uint16_t sample) {
     if (channel_index >= config_.channel_count) {
         return;
     }
     
+    if (is_logic(channel_index)) {
+        process_logic_sample(channel_index, sample);
+        return;
+    }
+    
     if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
         // Save filtered sample to buffer
-        signal_buffers_[channel_index][buffer_indices_[channel_index]] = sample;
-        buffer_indices_[channel_index] = (buffer_indices_[channel_index] + 1) % buffer_size_;
+        signal_buffers_[channel_index].samples[buffer_indices_[channel_index]] = sample;
+        buffer_indices_[channel_index] = (buffer_indices_[channel_index] + 1) % channel_buffer_size(channel_index);
+        
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+}
+
+void Sigscoper::process_logic_sample(size_t channel_index, uint16_t sample) {
+    // Threshold with hysteresis
+    uint16_t threshold = config_.logic_threshold[channel_index];
+    uint16_t hysteresis = config_.logic_hysteresis[channel_index];
+    bool state = logic_states_[channel_index];
+    
+    if (state && sample + hysteresis < threshold) {
+        state = false;
+    } else if (!state && sample >= threshold + hysteresis) {
+        state = true;
+    }
+    logic_states_[channel_index] = state;
+    
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        size_t bit_idx = buffer_indices_[channel_index];
+        uint32_t& word = signal_buffers_[channel_index].bits[bit_idx / 32];
+        uint32_t mask = 1u << (bit_idx % 32);
+        word = state ? (word | mask) : (word & ~mask);
+        
+        buffer_indices_[channel_index] = (bit_idx + 1) % logic_size_;
+        if (logic_filled_[channel_index] < logic_size_) {
+            logic_filled_[channel_index]++;
+        }
+        
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+}
+
+void Sigscoper::reset_logic_history(size_t group_index) {
+    // History must not join captures separated by the idle time between them
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        for (size_t i = 0; i < config_.channel_count; i++) {
+            if (is_logic(i) && channel_groups_[i] == group_index) {
+                logic_filled_[i] = 0;
+            }
+        }
+        
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+}
+
+uint32_t Sigscoper::get_logic_word(size_t channel_index, size_t bit_position) const {
+    // 32 consecutive samples starting at any bit of the ring
+    const uint32_t* bits = signal_buffers_[channel_index].bits;
+    size_t words = logic_size_ / 32;
+    size_t word_idx = (bit_position / 32) % words;
+    size_t shift = bit_position % 32;
+    
+    if (shift == 0) {
+        return bits[word_idx];
+    }
+    
+    return (bits[word_idx] >> shift) | (bits[(word_idx + 1) % words] << (32 - shift));
+}
+
+void Sigscoper::calculate_logic_stats(size_t channel_index, SigscoperLogicStats* stats) const {
+    size_t samples = logic_filled_[channel_index];
+    size_t start_idx = (buffer_indices_[channel_index] + logic_size_ - samples) % logic_size_;
+    
+    uint32_t high_count = 0;
+    uint32_t rising_edges = 0;
+    uint32_t falling_edges = 0;
+    int32_t first_rise = -1;
+    int32_t last_rise = -1;
+    uint32_t carry = 0;
+    
+    for (size_t offset = 0; offset < samples; offset += 32) {
+        uint32_t word = get_logic_word(channel_index, start_idx + offset);
+        size_t valid = samples - offset;
+        uint32_t mask = (valid >= 32) ? UINT32_MAX : ((1u << valid) - 1);
+        
+        // First sample has no predecessor, so it can't be an edge
+        if (offset == 0) {
+            carry = word & 1;
+        }
+        
+        // Each bit compared with the previous sample
+        uint32_t previous = (word << 1) | carry;
+        uint32_t rising = word & ~previous & mask;
+        uint32_t falling = ~word & previous & mask;
+        
+        high_count += __builtin_popcount(word & mask);
+        rising_edges += __builtin_popcount(rising);
+        falling_edges += __builtin_popcount(falling);
+        
+        if (rising) {
+            if (first_rise < 0) {
+                first_rise = offset + __builtin_ctz(rising);
+            }
+            last_rise = offset + 31 - __builtin_clz(rising);
+        }
+        
+        carry = word >> 31;
+    }
+    
+    stats->samples = samples;
+    stats->rising_edges = rising_edges;
+    stats->falling_edges = falling_edges;
+    stats->duty_cycle = (samples > 0) ? static_cast<float>(high_count) / samples : 0;
+    stats->frequency = 0;
+    
+    // Average period between first and last rising edge
+    if (rising_edges > 1 && last_rise > first_rise) {
+        float avg_period = static_cast<float>(last_rise - first_rise) / (rising_edges - 1);
+        stats->frequency = static_cast<float>(channel_rate(channel_index)) / avg_period;
+    }
+}
+
+bool Sigscoper::get_logic_stats(size_t index, SigscoperLogicStats* stats) const {
+    if (!stats || index >= config_.channel_count || !is_logic(index)) {
+        return false;
+    }
+    
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        calculate_logic_stats(index, stats);
+        
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+        return true;
+    }
+    
+    return false;
+}
+
+bool Sigscoper::get_logic_buffer(size_t index, size_t words, uint32_t* buffer, size_t* position) const {
+    if (!buffer || index >= config_.channel_count || !is_logic(index) || words == 0) {
+        return false;
+    }
+    
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        size_t copy_words = (words < logic_size_ / 32) ? words : logic_size_ / 32;
+        size_t start_idx = buffer_indices_[index];
+        
+        // Packed states, oldest first
+        for (size_t i = 0; i < copy_words; i++) {
+            buffer[i] = get_logic_word(index, start_idx + i * 32);
+        }
+        
+        *position = start_idx;
         
         xSemaphoreGive((SemaphoreHandle_t)mutex_);
+        return true;
     }
+    
+    return false;
+}
+
+uint16_t Sigscoper::take_oversampled(size_t channel_index) {
+    // Mean scaled by 2^n, i.e. a sum of 4^n samples shifted right by n for any sample count
+    uint32_t count = oversample_counts_[channel_index];
+    uint32_t sample = count ?
+        (oversample_sums_[channel_index] << config_.oversampling_bits) / count : 0;
+    
+    oversample_sums_[channel_index] = 0;
+    oversample_counts_[channel_index] = 0;
+    
+    return static_cast<uint16_t>(std::min(sample, static_cast<uint32_t>(UINT16_MAX)));
 }
 
 uint16_t Sigscoper::apply_median_filter(size_t channel_index, uint16_t sample) {
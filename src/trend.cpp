@@ -0,0 +1,189 @@
+#include "trend.h"
+#include "sigscoper.h"
+#include <new>
+
+static const uint32_t DEFAULT_TREND_PERIODS_MS[] = {1000, 60000, 3600000};
+
+Trend::Trend() {
+    channel_count_ = 0;
+    scale_count_ = 0;
+    memset(periods_ms_, 0, sizeof(periods_ms_));
+    scales_ = nullptr;
+    mutex_ = nullptr;
+}
+
+Trend::~Trend() {
+    delete[] scales_;
+    scales_ = nullptr;
+
+    if (mutex_) {
+        vSemaphoreDelete((SemaphoreHandle_t)mutex_);
+        mutex_ = nullptr;
+    }
+}
+
+bool Trend::begin(size_t channel_count) {
+    return begin(channel_count, DEFAULT_TREND_PERIODS_MS,
+                 sizeof(DEFAULT_TREND_PERIODS_MS) / sizeof(DEFAULT_TREND_PERIODS_MS[0]));
+}
+
+bool Trend::begin(size_t channel_count, const uint32_t* periods_ms, size_t scale_count) {
+    if (scales_ || channel_count == 0 || channel_count > MAX_CHANNELS) {
+        return false;
+    }
+
+    if (!periods_ms || scale_count == 0 || scale_count > TREND_MAX_SCALES) {
+        return false;
+    }
+
+    for (size_t i = 0; i < scale_count; i++) {
+        if (periods_ms[i] == 0) {
+            return false;
+        }
+        periods_ms_[i] = periods_ms[i];
+    }
+
+    mutex_ = xSemaphoreCreateMutex();
+    if (!mutex_) {
+        return false;
+    }
+
+    // All history storage is allocated here, update() never allocates
+    scales_ = new (std::nothrow) Scale[channel_count * scale_count];
+    if (!scales_) {
+        return false;
+    }
+
+    channel_count_ = channel_count;
+    scale_count_ = scale_count;
+    reset();
+
+    return true;
+}
+
+void Trend::reset() {
+    if (!scales_) {
+        return;
+    }
+
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        uint32_t now_ms = millis();
+        for (size_t i = 0; i < channel_count_ * scale_count_; i++) {
+            reset_accumulator(&scales_[i].accumulator, now_ms);
+            scales_[i].head = 0;
+            scales_[i].count = 0;
+        }
+
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+}
+
+Trend::Scale* Trend::get_scale(size_t channel, size_t scale) const {
+    if (!scales_ || channel >= channel_count_ || scale >= scale_count_) {
+        return nullptr;
+    }
+
+    return &scales_[channel * scale_count_ + scale];
+}
+
+void Trend::reset_accumulator(Accumulator* accumulator, uint32_t start_ms) {
+    accumulator->start_ms = start_ms;
+    accumulator->count = 0;
+    accumulator->frequency_count = 0;
+    accumulator->min_value = UINT16_MAX;
+    accumulator->max_value = 0;
+    accumulator->avg_sum = 0;
+    accumulator->frequency_sum = 0;
+}
+
+void Trend::fill_point(const Accumulator& accumulator, TrendPoint* point) {
+    point->timestamp_ms = accumulator.start_ms;
+    point->count = accumulator.count;
+    point->min_value = accumulator.min_value;
+    point->max_value = accumulator.max_value;
+    point->avg_value = (accumulator.count > 0) ? accumulator.avg_sum / accumulator.count : 0;
+    point->frequency = (accumulator.frequency_count > 0) ?
+        accumulator.frequency_sum / accumulator.frequency_count : 0;
+}
+
+void Trend::commit(Scale* scale) {
+    fill_point(scale->accumulator, &scale->points[scale->head]);
+    scale->head = (scale->head + 1) % TREND_HISTORY_LENGTH;
+    if (scale->count < TREND_HISTORY_LENGTH) {
+        scale->count++;
+    }
+}
+
+void Trend::update(size_t channel, const SigscoperStats& stats, uint32_t now_ms) {
+    if (!scales_ || channel >= channel_count_) {
+        return;
+    }
+
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        for (size_t i = 0; i < scale_count_; i++) {
+            Scale* scale = get_scale(channel, i);
+            Accumulator& accumulator = scale->accumulator;
+            uint32_t elapsed = now_ms - accumulator.start_ms;
+
+            // Close the bucket once its period is over, empty periods are not stored
+            if (elapsed >= periods_ms_[i]) {
+                if (accumulator.count > 0) {
+                    commit(scale);
+                }
+                reset_accumulator(&accumulator, now_ms - elapsed % periods_ms_[i]);
+            }
+
+            // Captures without valid samples only count toward the bucket
+            if (stats.min_value <= stats.max_value) {
+                if (stats.min_value < accumulator.min_value) accumulator.min_value = stats.min_value;
+                if (stats.max_value > accumulator.max_value) accumulator.max_value = stats.max_value;
+            }
+            accumulator.avg_sum += stats.avg_value;
+            accumulator.count++;
+
+            if (stats.frequency > 0) {
+                accumulator.frequency_sum += stats.frequency;
+                accumulator.frequency_count++;
+            }
+        }
+
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+}
+
+size_t Trend::get_history(size_t channel, size_t scale, TrendPoint* points, size_t max_points) const {
+    Scale* history = get_scale(channel, scale);
+    if (!history || !points || max_points == 0) {
+        return 0;
+    }
+
+    size_t copied = 0;
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        // Return the newest points, oldest first
+        copied = (history->count < max_points) ? history->count : max_points;
+        size_t start = (history->head + TREND_HISTORY_LENGTH - copied) % TREND_HISTORY_LENGTH;
+
+        for (size_t i = 0; i < copied; i++) {
+            points[i] = history->points[(start + i) % TREND_HISTORY_LENGTH];
+        }
+
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+    }
+
+    return copied;
+}
+
+bool Trend::get_current(size_t channel, size_t scale, TrendPoint* point) const {
+    Scale* history = get_scale(channel, scale);
+    if (!history || !point) {
+        return false;
+    }
+
+    if (xSemaphoreTake((SemaphoreHandle_t)mutex_, portMAX_DELAY) == pdTRUE) {
+        fill_point(history->accumulator, point);
+        xSemaphoreGive((SemaphoreHandle_t)mutex_);
+        return true;
+    }
+
+    return false;
+}